@@ -0,0 +1,96 @@
+#include "BenchReport.hpp"
+#include <algorithm>
+#include <iomanip>
+
+BenchReport::BenchReport() {}
+
+BenchReport::BenchReport(const BenchReport& other) : _series(other._series) {}
+
+BenchReport& BenchReport::operator=(const BenchReport& other)
+{
+	if (this != &other)
+		_series = other._series;
+	return *this;
+}
+
+BenchReport::~BenchReport() {}
+
+// Nearest-rank percentile; with few samples p99 is the slowest one
+double BenchReport::percentile(std::vector<double> sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	std::sort(sorted.begin(), sorted.end());
+	size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	if (rank > sorted.size())
+		rank = sorted.size();
+	return sorted[rank - 1];
+}
+
+// One sample for the series, created on first use in report order
+void BenchReport::add(const std::string& program, const std::string& workload, size_t size,
+	const std::string& metric, double items, double micros)
+{
+	for (size_t i = 0; i < _series.size(); ++i)
+	{
+		Series& series = _series[i];
+		if (series.program == program && series.workload == workload && series.size == size
+			&& series.metric == metric)
+		{
+			series.samples.push_back(micros);
+			return;
+		}
+	}
+	Series series;
+	series.program = program;
+	series.workload = workload;
+	series.size = size;
+	series.metric = metric;
+	series.items = items;
+	series.samples.push_back(micros);
+	_series.push_back(series);
+}
+
+void BenchReport::writeCsv(std::ostream& out) const
+{
+	out << "program,workload,size,metric,reps,median_us,p99_us,min_us,mean_us,items_per_s\n";
+	out << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < _series.size(); ++i)
+	{
+		const Series& s = _series[i];
+		double sum = 0;
+		for (size_t k = 0; k < s.samples.size(); ++k)
+			sum += s.samples[k];
+		double median = percentile(s.samples, 50);
+
+		out << s.program << ',' << s.workload << ',' << s.size << ',' << s.metric << ','
+			<< s.samples.size() << ',' << median << ',' << percentile(s.samples, 99) << ','
+			<< percentile(s.samples, 0) << ',' << sum / s.samples.size() << ','
+			<< (median > 0 ? s.items / (median / 1e6) : 0) << '\n';
+	}
+}
+
+// Metric names are plain labels without quotes or backslashes
+void BenchReport::writeJson(std::ostream& out) const
+{
+	out << "[\n" << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < _series.size(); ++i)
+	{
+		const Series& s = _series[i];
+		double sum = 0;
+		for (size_t k = 0; k < s.samples.size(); ++k)
+			sum += s.samples[k];
+		double median = percentile(s.samples, 50);
+
+		out << "  {\"program\": \"" << s.program << "\", \"workload\": \"" << s.workload
+			<< "\", \"size\": " << s.size << ", \"metric\": \"" << s.metric
+			<< "\", \"reps\": " << s.samples.size() << ", \"median_us\": " << median
+			<< ", \"p99_us\": " << percentile(s.samples, 99) << ", \"min_us\": " << percentile(s.samples, 0)
+			<< ", \"mean_us\": " << sum / s.samples.size()
+			<< ", \"items_per_s\": " << (median > 0 ? s.items / (median / 1e6) : 0) << "}"
+			<< (i + 1 < _series.size() ? ",\n" : "\n");
+	}
+	out << "]\n";
+}
@@ -0,0 +1,43 @@
+#ifndef BENCHREPORT_HPP
+#define BENCHREPORT_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstddef>
+
+// Timing samples grouped into series, one series per measured quantity of
+// one workload, summarised as median, p99, min and mean plus throughput
+// (items per second at the median) and written as CSV or JSON.
+class BenchReport
+{
+public:
+	struct Series
+	{
+		std::string program;
+		std::string workload;
+		size_t size;
+		std::string metric;
+		double items;
+		std::vector<double> samples;	// microseconds
+	};
+
+private:
+	std::vector<Series> _series;
+
+	static double percentile(std::vector<double> sorted, double p);
+
+public:
+	BenchReport();
+	BenchReport(const BenchReport& other);
+	BenchReport& operator=(const BenchReport& other);
+	~BenchReport();
+
+	// Methods
+	void add(const std::string& program, const std::string& workload, size_t size,
+		const std::string& metric, double items, double micros);
+	void writeCsv(std::ostream& out) const;
+	void writeJson(std::ostream& out) const;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "Workloads.hpp"
+#include <fstream>
+#include <cstdio>
+
+Workloads::Random::Random(unsigned long long seed) : _state(seed) {}
+
+unsigned long long Workloads::Random::next()
+{
+	unsigned long long z = (_state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+unsigned int Workloads::Random::below(unsigned int bound)
+{
+	return static_cast<unsigned int>(next() % bound);
+}
+
+bool Workloads::writeNumbers(const std::string& path, const std::string& order, size_t count,
+	unsigned long long seed)
+{
+	const unsigned long long maxValue = 2147483647ULL;
+	std::ofstream out(path.c_str());
+	Random random(seed);
+	unsigned long long distinct = count / 10 + 1;
+
+	for (size_t i = 0; i < count && out; ++i)
+	{
+		unsigned long long value;
+		if (order == "sorted")
+			value = 1 + i * (maxValue - 1) / (count ? count : 1);
+		else if (order == "reversed")
+			value = 1 + (count - 1 - i) * (maxValue - 1) / (count ? count : 1);
+		else if (order == "duplicates")
+			value = 1 + random.next() % distinct;
+		else
+			value = 1 + random.next() % maxValue;
+		out << value << '\n';
+	}
+	return static_cast<bool>(out);
+}
+
+bool Workloads::writeQueries(const std::string& path, size_t lines, unsigned long long seed)
+{
+	static const char* const broken[] = { "2001-42-42", "2012-01-11 | -1", "2012-01-11 | 2147483648",
+										  "2008-01-01 | 1", "not a line" };
+	std::ofstream out(path.c_str());
+	Random random(seed);
+	char line[64];
+
+	out << "date | value\n";
+	for (size_t i = 0; i < lines && out; ++i)
+	{
+		if (random.below(20) == 0)
+		{
+			out << broken[random.below(5)] << '\n';
+			continue;
+		}
+		unsigned int year = 2009 + random.below(14);
+		unsigned int month = 1 + random.below(12);
+		unsigned int day = 1 + random.below(28);
+		unsigned int value = random.below(100000);
+		std::sprintf(line, "%04u-%02u-%02u | %u.%02u\n", year, month, day, value / 100, value % 100);
+		out << line;
+	}
+	return static_cast<bool>(out);
+}
+
+namespace
+{
+	const char OPERATORS[] = { '+', '-', '*', '/' };
+}
+
+std::string Workloads::expression(size_t operators, unsigned long long seed)
+{
+	Random random(seed);
+	std::string text(1, static_cast<char>('1' + random.below(9)));
+
+	text.reserve(4 * operators + 1);
+	for (size_t i = 0; i < operators; ++i)
+	{
+		// Mostly + and -, so the value stays small however long the chain
+		char op = random.below(8) == 0 ? OPERATORS[2 + random.below(2)] : OPERATORS[random.below(2)];
+		text += ' ';
+		text += static_cast<char>('1' + random.below(9));
+		text += ' ';
+		text += op;
+	}
+	return text;
+}
+
+bool Workloads::writeExpressions(const std::string& path, size_t lines, unsigned long long seed)
+{
+	std::ofstream out(path.c_str());
+	Random random(seed);
+
+	for (size_t i = 0; i < lines && out; ++i)
+		out << expression(2 + random.below(6), random.next()) << '\n';
+	return static_cast<bool>(out);
+}
+
+bool Workloads::writeRepeated(const std::string& path, size_t lines, unsigned long long seed)
+{
+	std::ofstream out(path.c_str());
+	std::string line = expression(16, seed) + '\n';
+
+	for (size_t i = 0; i < lines && out; ++i)
+		out << line;
+	return static_cast<bool>(out);
+}
+
+bool Workloads::writeColumns(const std::string& path, size_t rows, size_t count, unsigned long long seed)
+{
+	std::ofstream out(path.c_str());
+	Random random(seed);
+	std::string line;
+
+	for (size_t i = 0; i < rows && out; ++i)
+	{
+		line.clear();
+		for (size_t k = 0; k < count; ++k)
+		{
+			line += k ? " " : "";
+			line += static_cast<char>('1' + random.below(9));
+		}
+		out << line << '\n';
+	}
+	return static_cast<bool>(out);
+}
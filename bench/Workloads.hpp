@@ -0,0 +1,48 @@
+#ifndef WORKLOADS_HPP
+#define WORKLOADS_HPP
+
+#include <string>
+#include <cstddef>
+
+// Reproducible inputs for the benchmarks: every generator is driven by its
+// own seeded PRNG, so a seed names the exact same bytes on every machine.
+namespace Workloads
+{
+	// splitmix64
+	class Random
+	{
+	private:
+		unsigned long long _state;
+
+	public:
+		explicit Random(unsigned long long seed);
+
+		unsigned long long next();
+		unsigned int below(unsigned int bound);
+	};
+
+	// PmergeMe numbers, one per line, in [1, 2^31 - 1]. order is "random",
+	// "sorted", "reversed" or "duplicates" (random over count / 10 values).
+	bool writeNumbers(const std::string& path, const std::string& order, size_t count,
+		unsigned long long seed);
+
+	// btc input: header, then "date | value" lines, about one in twenty of
+	// them malformed or out of range
+	bool writeQueries(const std::string& path, size_t lines, unsigned long long seed);
+
+	// RPN: one chain "d d op d op ..." with the given number of operators,
+	// right operands 1-9 so that division never sees zero
+	std::string expression(size_t operators, unsigned long long seed);
+
+	// RPN batch input: lines expressions of a few operators each
+	bool writeExpressions(const std::string& path, size_t lines, unsigned long long seed);
+
+	// RPN batch input: one formula of 16 operators on every line, the case
+	// batch mode compiles once
+	bool writeRepeated(const std::string& path, size_t lines, unsigned long long seed);
+
+	// RPN --columns input: rows of count values 1-9, one per operand slot
+	bool writeColumns(const std::string& path, size_t rows, size_t count, unsigned long long seed);
+}
+
+#endif
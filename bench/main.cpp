@@ -0,0 +1,387 @@
+#include "BenchReport.hpp"
+#include "Workloads.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Benchmarks for btc, RPN and PmergeMe: each workload is generated once
+// from the seed, run warmup times unmeasured and reps times measured, with
+// the binary under test as a child process.
+namespace
+{
+	struct Options
+	{
+		std::string program;
+		std::string binary;
+		std::vector<std::string> args;
+		std::vector<size_t> sizes;
+		size_t reps;
+		size_t warmup;
+		std::string format;
+		std::string out;
+		std::string workdir;
+		unsigned long long seed;
+		bool keep;
+	};
+
+	double nowMicros()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+	}
+
+	// Runs args with stdout to outputPath and stderr discarded; micros is
+	// the wall time from fork to exit. False, with the reason in failure,
+	// if the child could not run, exited non-zero or was killed, since a
+	// timing of a failed run measures the error path.
+	bool runProcess(const std::vector<std::string>& args, const std::string& outputPath, double& micros,
+		std::string& failure)
+	{
+		std::vector<char*> argv;
+		for (size_t i = 0; i < args.size(); ++i)
+			argv.push_back(const_cast<char*>(args[i].c_str()));
+		argv.push_back(NULL);
+
+		double start = nowMicros();
+		pid_t pid = fork();
+		if (pid < 0)
+		{
+			failure = std::strerror(errno);
+			return false;
+		}
+		if (pid == 0)
+		{
+			int out = ::open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			int null = ::open("/dev/null", O_WRONLY);
+			if (out < 0 || null < 0)
+				_exit(127);
+			dup2(out, 1);
+			dup2(null, 2);
+			execv(argv[0], &argv[0]);
+			_exit(127);
+		}
+		int status;
+		if (waitpid(pid, &status, 0) < 0)
+		{
+			failure = std::strerror(errno);
+			return false;
+		}
+		micros = nowMicros() - start;
+
+		std::ostringstream reason;
+		if (WIFEXITED(status) && WEXITSTATUS(status) == 127)
+			reason << "could not be started";
+		else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+			reason << "exited with status " << WEXITSTATUS(status);
+		else if (WIFSIGNALED(status))
+			reason << "was killed by signal " << WTERMSIG(status);
+		failure = reason.str();
+		return failure.empty();
+	}
+
+	std::vector<size_t> parseSizes(const std::string& list)
+	{
+		std::vector<size_t> sizes;
+		std::istringstream in(list);
+		std::string item;
+
+		while (std::getline(in, item, ','))
+		{
+			unsigned long value = std::strtoul(item.c_str(), NULL, 10);
+			if (value > 0)
+				sizes.push_back(value);
+		}
+		return sizes;
+	}
+
+	// Series names from PmergeMe's labels: "std::vector (parallel, 4
+	// threads)" becomes "std::vector_parallel_4_threads"
+	std::string metricName(const std::string& label)
+	{
+		std::string name;
+		for (size_t i = 0; i < label.size(); ++i)
+		{
+			char c = label[i];
+			bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == ':';
+			if (keep)
+				name += c;
+			else if (!name.empty() && name[name.size() - 1] != '_')
+				name += '_';
+		}
+		while (!name.empty() && name[name.size() - 1] == '_')
+			name.erase(name.size() - 1);
+		return name;
+	}
+
+	std::string dataPath(const Options& options, const std::string& workload, size_t size)
+	{
+		std::ostringstream path;
+		path << options.workdir << "/bench_" << options.program << '_' << workload << '_' << size << ".txt";
+		return path.str();
+	}
+
+	std::vector<std::string> command(const Options& options)
+	{
+		std::vector<std::string> args(1, options.binary);
+		args.insert(args.end(), options.args.begin(), options.args.end());
+		return args;
+	}
+
+	// warmup + reps runs of args, the measured ones recorded as "wall"
+	bool measure(const Options& options, BenchReport& report, const std::vector<std::string>& args,
+		const std::string& workload, size_t size, double items, const std::string& outputPath,
+		void (*parse)(const std::string&, const std::string&, size_t, BenchReport&))
+	{
+		for (size_t run = 0; run < options.warmup + options.reps; ++run)
+		{
+			double micros;
+			std::string failure;
+			if (!runProcess(args, outputPath, micros, failure))
+			{
+				std::cerr << "bench: " << args[0] << ' ' << failure << " on " << workload << ' ' << size << std::endl;
+				return false;
+			}
+			if (run < options.warmup)
+				continue;
+			report.add(options.program, workload, size, "wall", items, micros);
+			if (parse)
+				parse(outputPath, workload, size, report);
+		}
+		return true;
+	}
+
+	// "Time to process a range of N elements with LABEL : T us"
+	void parsePmergeMe(const std::string& outputPath, const std::string& workload, size_t size, BenchReport& report)
+	{
+		std::ifstream in(outputPath.c_str());
+		std::string line;
+		const std::string prefix = "Time to process a range of ";
+
+		while (std::getline(in, line))
+		{
+			if (line.compare(0, prefix.size(), prefix) != 0)
+				continue;
+			size_t with = line.find(" elements with ");
+			size_t colon = line.rfind(" : ");
+			if (with == std::string::npos || colon == std::string::npos || colon < with)
+				continue;
+			std::string label = line.substr(with + 15, colon - with - 15);
+			double micros = std::strtod(line.c_str() + colon + 3, NULL);
+			report.add("pmergeme", workload, size, metricName(label), size, micros);
+		}
+	}
+
+	bool benchPmergeMe(const Options& options, BenchReport& report, std::vector<std::string>& files)
+	{
+		static const char* const orders[] = { "random", "sorted", "reversed", "duplicates" };
+		std::string output = options.workdir + "/bench_pmergeme_output.txt";
+		files.push_back(output);
+
+		for (size_t s = 0; s < options.sizes.size(); ++s)
+		{
+			for (size_t o = 0; o < 4; ++o)
+			{
+				size_t size = options.sizes[s];
+				std::string path = dataPath(options, orders[o], size);
+				files.push_back(path);
+				if (!Workloads::writeNumbers(path, orders[o], size, options.seed + size * 4 + o))
+					return false;
+
+				std::vector<std::string> args = command(options);
+				args.push_back("--file");
+				args.push_back(path);
+				std::cerr << "bench: pmergeme " << orders[o] << ' ' << size << std::endl;
+				if (!measure(options, report, args, orders[o], size, size, output, &parsePmergeMe))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	bool benchBtc(const Options& options, BenchReport& report, std::vector<std::string>& files)
+	{
+		for (size_t s = 0; s < options.sizes.size(); ++s)
+		{
+			size_t size = options.sizes[s];
+			std::string path = dataPath(options, "queries", size);
+			files.push_back(path);
+			if (!Workloads::writeQueries(path, size, options.seed + size))
+				return false;
+
+			std::vector<std::string> args = command(options);
+			args.push_back(path);
+			std::cerr << "bench: btc queries " << size << std::endl;
+			if (!measure(options, report, args, "queries", size, size, "/dev/null", NULL))
+				return false;
+		}
+		return true;
+	}
+
+	// Long single expressions go through argv, which caps them well below
+	// the kernel's 128 KiB per-argument limit; batches go through a file
+	bool benchRpn(const Options& options, BenchReport& report, std::vector<std::string>& files)
+	{
+		const size_t maxOperators = 25000;
+
+		for (size_t s = 0; s < options.sizes.size(); ++s)
+		{
+			size_t size = options.sizes[s];
+			if (size <= maxOperators)
+			{
+				std::vector<std::string> args = command(options);
+				args.push_back(Workloads::expression(size, options.seed + size));
+				std::cerr << "bench: rpn expression " << size << std::endl;
+				if (!measure(options, report, args, "expression", size, size, "/dev/null", NULL))
+					return false;
+			}
+			else
+				std::cerr << "bench: rpn expression " << size << " skipped, too long for argv" << std::endl;
+
+			std::string path = dataPath(options, "batch", size);
+			files.push_back(path);
+			if (!Workloads::writeExpressions(path, size, options.seed + size))
+				return false;
+			std::vector<std::string> args = command(options);
+			args.insert(args.begin() + 1, "--batch");
+			args.push_back(path);
+			std::cerr << "bench: rpn batch " << size << std::endl;
+			if (!measure(options, report, args, "batch", size, size, "/dev/null", NULL))
+				return false;
+
+			path = dataPath(options, "repeat", size);
+			files.push_back(path);
+			if (!Workloads::writeRepeated(path, size, options.seed + size))
+				return false;
+			args.back() = path;
+			std::cerr << "bench: rpn repeat " << size << std::endl;
+			if (!measure(options, report, args, "repeat", size, size, "/dev/null", NULL))
+				return false;
+
+			// The repeat formula once more, its 17 numbers bound to columns
+			path = dataPath(options, "columns", size);
+			files.push_back(path);
+			if (!Workloads::writeColumns(path, size, 17, options.seed + size))
+				return false;
+			args = command(options);
+			args.insert(args.begin() + 1, "--columns");
+			args.insert(args.begin() + 2, path);
+			args.push_back(Workloads::expression(16, options.seed + size));
+			std::cerr << "bench: rpn columns " << size << std::endl;
+			if (!measure(options, report, args, "columns", size, size, "/dev/null", NULL))
+				return false;
+		}
+		return true;
+	}
+
+	void usage()
+	{
+		std::cerr << "Usage: ./bench btc|rpn|pmergeme BINARY [--reps N] [--warmup N] [--sizes A,B,...]\n"
+				  << "               [--format csv|json] [--out FILE] [--seed N] [--workdir DIR]\n"
+				  << "               [--keep] [-- BINARY_ARGS...]" << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		usage();
+		return 1;
+	}
+
+	Options options;
+	options.program = argv[1];
+	options.binary = argv[2];
+	options.reps = 5;
+	options.warmup = 1;
+	options.format = "csv";
+	options.seed = 42;
+	options.keep = false;
+	const char* tmp = std::getenv("TMPDIR");
+	options.workdir = tmp && *tmp ? tmp : "/tmp";
+
+	if (options.program == "pmergeme")
+		options.sizes = parseSizes("10,100,1000,10000,100000");
+	else if (options.program == "btc")
+		options.sizes = parseSizes("10000,100000,1000000");
+	else if (options.program == "rpn")
+		options.sizes = parseSizes("1000,10000,100000");
+	else
+	{
+		usage();
+		return 1;
+	}
+
+	for (int i = 3; i < argc; ++i)
+	{
+		std::string opt(argv[i]);
+		bool hasValue = i + 1 < argc;
+
+		if (opt == "--")
+		{
+			options.args.assign(argv + i + 1, argv + argc);
+			break;
+		}
+		else if (opt == "--keep")
+			options.keep = true;
+		else if (opt == "--reps" && hasValue)
+			options.reps = std::strtoul(argv[++i], NULL, 10);
+		else if (opt == "--warmup" && hasValue)
+			options.warmup = std::strtoul(argv[++i], NULL, 10);
+		else if (opt == "--sizes" && hasValue)
+			options.sizes = parseSizes(argv[++i]);
+		else if (opt == "--format" && hasValue)
+			options.format = argv[++i];
+		else if (opt == "--out" && hasValue)
+			options.out = argv[++i];
+		else if (opt == "--seed" && hasValue)
+			options.seed = std::strtoull(argv[++i], NULL, 10);
+		else if (opt == "--workdir" && hasValue)
+			options.workdir = argv[++i];
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (options.reps == 0 || options.sizes.empty() || (options.format != "csv" && options.format != "json"))
+	{
+		usage();
+		return 1;
+	}
+
+	BenchReport report;
+	std::vector<std::string> files;
+	bool ok;
+	if (options.program == "pmergeme")
+		ok = benchPmergeMe(options, report, files);
+	else if (options.program == "btc")
+		ok = benchBtc(options, report, files);
+	else
+		ok = benchRpn(options, report, files);
+
+	if (!options.keep)
+		for (size_t i = 0; i < files.size(); ++i)
+			std::remove(files[i].c_str());
+
+	std::ofstream file;
+	if (!options.out.empty())
+		file.open(options.out.c_str());
+	std::ostream& out = options.out.empty() ? std::cout : file;
+	if (options.format == "json")
+		report.writeJson(out);
+	else
+		report.writeCsv(out);
+	return ok ? 0 : 1;
+}
@@ -1,226 +1,561 @@
 #include "BitcoinExchange.hpp"
-#include <fstream>
-#include <sstream>
+#include "OutputBuffer.hpp"
+#include "Snapshot.hpp"
+#include "MappedFile.hpp"
 #include <iostream>
 #include <cstdlib>
-#include <limits>
+#include <cstring>
+#include <vector>
+#include <pthread.h>
 
 // Orthodox Canonical Form
-BitcoinExchange::BitcoinExchange() {}
+BitcoinExchange::BitcoinExchange()
+	: _denseLookup(false), _fixedPoint(false), _useSnapshot(true), _threads(1) {}
 
-BitcoinExchange::BitcoinExchange(const BitcoinExchange& other) : _data(other._data) {}
+BitcoinExchange::BitcoinExchange(const BitcoinExchange& other)
+	: _index(other._index), _denseLookup(other._denseLookup), _fixedPoint(other._fixedPoint),
+	  _useSnapshot(other._useSnapshot),
+	  _threads(other._threads) {}
 
 BitcoinExchange& BitcoinExchange::operator=(const BitcoinExchange& other)
 {
 	if (this != &other)
-		_data = other._data;
+	{
+		_index = other._index;
+		_denseLookup = other._denseLookup;
+		_fixedPoint = other._fixedPoint;
+		_useSnapshot = other._useSnapshot;
+		_threads = other._threads;
+	}
 	return *this;
 }
 
 BitcoinExchange::~BitcoinExchange() {}
 
 // Helper functions
-std::string BitcoinExchange::trim(const std::string& str) const
+
+// Narrow [begin, end) of str to exclude surrounding whitespace
+void BitcoinExchange::trim(const char* str, size_t& begin, size_t& end)
 {
-	size_t first = str.find_first_not_of(" \t\n\r");
-	if (first == std::string::npos)
-		return "";
-	size_t last = str.find_last_not_of(" \t\n\r");
-	return str.substr(first, (last - first + 1));
+	while (begin < end && std::strchr(" \t\n\r", str[begin]) && str[begin] != '\0')
+		++begin;
+	while (end > begin && std::strchr(" \t\n\r", str[end - 1]) && str[end - 1] != '\0')
+		--end;
 }
 
-bool BitcoinExchange::parseDate(const std::string& date, int& year, int& month, int& day) const
+namespace
 {
-	if (date.length() != 10 || date[4] != '-' || date[7] != '-')
+	// Days in a common year before the first of each month (1-based), and
+	// before the first of the following year
+	const int DAYS_BEFORE_MONTH[14] = { 0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 };
+}
+
+// One pass over a "YYYY-MM-DD" date: checks the layout and the calendar and
+// yields the day number, counted from 0000-01-01 in the proleptic Gregorian
+// calendar, so later dates get larger numbers
+bool BitcoinExchange::parseDate(const char* date, size_t length, unsigned int& dayNumber)
+{
+	if (length != 10 || date[4] != '-' || date[7] != '-')
+		return false;
+
+	// Fixed positions: every byte but the two dashes must be a digit
+	unsigned int bad = 0;
+	for (size_t i = 0; i < 10; ++i)
+		bad |= (i != 4 && i != 7) & (static_cast<unsigned int>(static_cast<unsigned char>(date[i]) - '0') > 9);
+	if (bad)
+		return false;
+
+	int year = (date[0] - '0') * 1000 + (date[1] - '0') * 100 + (date[2] - '0') * 10 + (date[3] - '0');
+	int month = (date[5] - '0') * 10 + (date[6] - '0');
+	int day = (date[8] - '0') * 10 + (date[9] - '0');
+	if (month < 1 || month > 12)
+		return false;
+
+	int leap = (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
+	int extra = leap & (month == 2);
+	if (day < 1 || day > DAYS_BEFORE_MONTH[month + 1] - DAYS_BEFORE_MONTH[month] + extra)
 		return false;
 
-	for (size_t i = 0; i < date.length(); ++i)
+	// Leap days in the years before this one, plus this year's if it is past
+	int leapDays = (year + 3) / 4 - (year + 99) / 100 + (year + 399) / 400 + (leap & (month > 2));
+	dayNumber = 365 * year + leapDays + DAYS_BEFORE_MONTH[month] + day - 1;
+	return true;
+}
+
+// The "[+-]digits[.digits]" grammar of both files; digits may be missing
+// on one side of the point. Up to 19 significant digits are kept as an
+// integer with the number of them after the point.
+bool BitcoinExchange::parseDecimal(const char* str, size_t length, Decimal& number)
+{
+	size_t i = 0;
+	size_t count = 0;
+	size_t significant = 0;
+	bool point = false;
+
+	number.digits = 0;
+	number.scale = 0;
+	number.negative = false;
+	if (length > 0 && (str[0] == '-' || str[0] == '+'))
+		number.negative = str[i++] == '-';
+	for (; i < length; ++i)
 	{
-		if (i == 4 || i == 7)
+		if (str[i] == '.' && !point)
+		{
+			point = true;
 			continue;
-		if (!isdigit(date[i]))
+		}
+		unsigned int d = static_cast<unsigned char>(str[i]) - '0';
+		if (d > 9)
 			return false;
+		++count;
+		if (significant > 0 || d != 0)
+			++significant;
+		if (significant <= 19)
+		{
+			number.digits = number.digits * 10 + d;
+			number.scale += point;
+		}
 	}
+	number.exact = significant <= 19;
+	return count > 0;
+}
 
-	year = atoi(date.substr(0, 4).c_str());
-	month = atoi(date.substr(5, 2).c_str());
-	day = atoi(date.substr(8, 2).c_str());
+// The correctly rounded double of a parsed number. Below 2^53 the digits
+// and the power of ten are both exact doubles, so one division rounds once
+// to the right answer; longer numbers go to strtod on a terminated copy,
+// since mapped bytes have no terminator.
+double BitcoinExchange::toDouble(const Decimal& number, const char* str, size_t length)
+{
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+									 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	static const unsigned long long exactLimit = static_cast<unsigned long long>(1) << 53;
 
-	return true;
+	if (number.exact && number.digits <= exactLimit && number.scale <= 22)
+	{
+		double value = static_cast<double>(number.digits) / powers[number.scale];
+		return number.negative ? -value : value;
+	}
+
+	char copy[64];
+	if (length < sizeof(copy))
+	{
+		std::memcpy(copy, str, length);
+		copy[length] = '\0';
+		return std::strtod(copy, NULL);
+	}
+	std::string longCopy(str, length);
+	return std::strtod(longCopy.c_str(), NULL);
 }
 
-bool BitcoinExchange::isValidDate(const std::string& date) const
+bool BitcoinExchange::parseRate(const char* str, size_t length, double& value) const
 {
-	int year, month, day;
-	
-	if (!parseDate(date, year, month, day))
+	Decimal number;
+	if (!parseDecimal(str, length, number))
 		return false;
+	value = toDouble(number, str, length);
+	return true;
+}
 
-	if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31)
-		return false;
+// Rows of "date,rate" in data[0, size); the first line is a header.
+// Rows that do not parse are skipped.
+void BitcoinExchange::loadRows(const char* data, size_t size)
+{
+	const char* end = data + size;
+	const char* line = static_cast<const char*>(std::memchr(data, '\n', size));
 
-	// Check days in month
-	int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-	
-	// Check for leap year
-	if (month == 2)
+	// Skip header line
+	line = line ? line + 1 : end;
+	while (line < end)
 	{
-		bool isLeap = (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
-		if (isLeap && day > 29)
-			return false;
-		if (!isLeap && day > 28)
-			return false;
+		const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		size_t length = (newline ? newline : end) - line;
+		const char* comma = static_cast<const char*>(std::memchr(line, ',', length));
+
+		if (comma)
+		{
+			size_t dateBegin = 0, dateEnd = comma - line;
+			size_t valueBegin = dateEnd + 1, valueEnd = length;
+			trim(line, dateBegin, dateEnd);
+			trim(line, valueBegin, valueEnd);
+
+			unsigned int day;
+			double value;
+			if (parseDate(line + dateBegin, dateEnd - dateBegin, day)
+				&& parseRate(line + valueBegin, valueEnd - valueBegin, value))
+				_index.add(day, value);
+		}
+		line = newline ? newline + 1 : end;
 	}
-	else if (day > daysInMonth[month - 1])
+}
+
+// The database is mapped and scanned in place. With snapshots on, a
+// snapshot matching the CSV replaces the parse, and a fresh parse
+// rewrites the snapshot.
+bool BitcoinExchange::loadDatabase(const std::string& filename)
+{
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		std::cerr << "Error: could not open database file." << std::endl;
 		return false;
+	}
 
+	std::string snapshotPath = Snapshot::pathFor(filename);
+	bool snapshot = _useSnapshot && file.isRegular();
+
+	if (snapshot && Snapshot::load(snapshotPath, file.info(), _index))
+	{
+		if (_denseLookup)
+			_index.buildDense();
+		if (_fixedPoint)
+			_index.buildFixed();
+		return true;
+	}
+
+	file.load();
+	loadRows(file.data(), file.size());
+	file.close();
+
+	_index.build();
+	if (snapshot)
+		Snapshot::save(snapshotPath, file.info(), _index);
+	if (_denseLookup)
+		_index.buildDense();
+	if (_fixedPoint)
+		_index.buildFixed();
 	return true;
 }
 
-bool BitcoinExchange::isValidValue(const std::string& valueStr, double& value) const
+// Resolve queries through a per-day rate table built at load time
+void BitcoinExchange::setDenseLookup(bool enabled)
 {
-	char* endptr;
-	value = strtod(valueStr.c_str(), &endptr);
+	_denseLookup = enabled;
+}
 
-	// Check if conversion was successful
-	if (*endptr != '\0' && *endptr != '\n')
-		return false;
+// Answer with exact decimal arithmetic on fixed-point rates where the
+// numbers allow it: results are then rounded once, from the exact product
+void BitcoinExchange::setFixedPoint(bool enabled)
+{
+	_fixedPoint = enabled;
+}
 
-	return true;
+// Read and write the binary snapshot next to the database (on by default)
+void BitcoinExchange::setUseSnapshot(bool enabled)
+{
+	_useSnapshot = enabled;
 }
 
-std::string BitcoinExchange::findClosestDate(const std::string& date) const
+// Split the input over this many threads (1 keeps it on the calling thread)
+void BitcoinExchange::setThreads(size_t threads)
 {
-	std::map<std::string, double>::const_iterator it = _data.lower_bound(date);
-	
-	// If exact match found
-	if (it != _data.end() && it->first == date)
-		return it->first;
-	
-	// If lower_bound returns begin, no lower date exists
-	if (it == _data.begin())
-		return "";
-	
-	// Go to the previous element (closest lower date)
-	--it;
-	return it->first;
+	_threads = threads ? threads : 1;
 }
 
-bool BitcoinExchange::loadDatabase(const std::string& filename)
+namespace
 {
-	std::ifstream file(filename.c_str());
-	if (!file.is_open())
+	// Phase stamps of the line being answered: stamps[0] when it has been
+	// parsed and validated, stamps[1] when the lookup is done. NULL when
+	// nobody is measuring.
+	void markParsed(double* stamps)
 	{
-		std::cerr << "Error: could not open database file." << std::endl;
-		return false;
+		if (stamps)
+			stamps[0] = stamps[1] = QueryMetrics::now();
 	}
 
-	std::string line;
-	bool firstLine = true;
+	void markLooked(double* stamps)
+	{
+		if (stamps)
+			stamps[1] = QueryMetrics::now();
+	}
+}
 
-	while (std::getline(file, line))
+// Queries in data[0, size), whole lines only; fields are views into the
+// mapped bytes and results go to out. With metrics, each line's outcome
+// and phase times are recorded there.
+void BitcoinExchange::processLines(const char* data, size_t size, OutputBuffer& out,
+	QueryMetrics* metrics) const
+{
+	const char* end = data + size;
+	const char* line = data;
+	size_t hint = 0;
+	double mark = metrics ? QueryMetrics::now() : 0;
+
+	while (line < end)
 	{
-		// Skip header line
-		if (firstLine)
+		const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		size_t length = (newline ? newline : end) - line;
+		const char* next = newline ? newline + 1 : end;
+
+		if (!metrics)
 		{
-			firstLine = false;
+			answerLine(line, length, out, hint, NULL);
+			line = next;
 			continue;
 		}
 
-		size_t commaPos = line.find(',');
-		if (commaPos == std::string::npos)
-			continue;
+		double stamps[2];
+		QueryMetrics::Outcome outcome = answerLine(line, length, out, hint, stamps);
+		double done = QueryMetrics::now();
+		metrics->record(outcome, stamps[0] - mark, stamps[1] - stamps[0], done - stamps[1]);
+		mark = done;
+		line = next;
+	}
+}
 
-		std::string date = trim(line.substr(0, commaPos));
-		std::string valueStr = trim(line.substr(commaPos + 1));
+// One query line of length bytes, without its newline. hint carries the
+// index position from line to line.
+QueryMetrics::Outcome BitcoinExchange::answerLine(const char* line, size_t length, OutputBuffer& out,
+	size_t& hint, double* stamps) const
+{
+	const char* pipe = static_cast<const char*>(std::memchr(line, '|', length));
 
-		if (!isValidDate(date))
-			continue;
+	if (!pipe)
+	{
+		size_t begin = 0, stop = length;
+		trim(line, begin, stop);
+		markParsed(stamps);
+		out.to(2).put("Error: bad input => ").put(line + begin, stop - begin).put("\n");
+		return QueryMetrics::BAD_INPUT;
+	}
 
-		double value;
-		if (!isValidValue(valueStr, value))
-			continue;
+	size_t dateBegin = 0, dateEnd = pipe - line;
+	size_t valueBegin = dateEnd + 1, valueEnd = length;
+	trim(line, dateBegin, dateEnd);
+	trim(line, valueBegin, valueEnd);
+	const char* date = line + dateBegin;
+	size_t dateLength = dateEnd - dateBegin;
+	const char* valueStr = line + valueBegin;
+	size_t valueLength = valueEnd - valueBegin;
+
+	// Validate date
+	unsigned int day;
+	if (!parseDate(date, dateLength, day))
+	{
+		markParsed(stamps);
+		out.to(2).put("Error: bad input => ").put(date, dateLength).put("\n");
+		return QueryMetrics::BAD_INPUT;
+	}
 
-		_data[date] = value;
+	// Validate value
+	Decimal amount;
+	if (!parseDecimal(valueStr, valueLength, amount))
+	{
+		markParsed(stamps);
+		out.to(2).put("Error: bad input => ").put(date, dateLength).put("\n");
+		return QueryMetrics::BAD_INPUT;
 	}
+	double value = toDouble(amount, valueStr, valueLength);
 
-	file.close();
-	return true;
-}
+	// Check if value is negative
+	if (value < 0)
+	{
+		markParsed(stamps);
+		out.to(2).put("Error: not a positive number.\n");
+		return QueryMetrics::NOT_POSITIVE;
+	}
 
-void BitcoinExchange::processInputFile(const std::string& filename)
-{
-	std::ifstream file(filename.c_str());
-	if (!file.is_open())
+	// Check if value is too large
+	if (value > 1000)
 	{
-		std::cerr << "Error: could not open file." << std::endl;
-		return;
+		markParsed(stamps);
+		out.to(2).put("Error: too large a number.\n");
+		return QueryMetrics::TOO_LARGE;
 	}
+	markParsed(stamps);
 
-	std::string line;
-	bool firstLine = true;
+	// Find the exchange rate of the closest earlier date
+	double rate;
+	unsigned long long fixedRate;
+	bool fixed = _fixedPoint && amount.exact && _index.hasFixed();
+	if (!(fixed ? _index.findClosestFixed(day, fixedRate, hint) : _index.findClosest(day, rate, hint)))
+	{
+		markLooked(stamps);
+		out.to(2).put("Error: no data available for date => ").put(date, dateLength).put("\n");
+		return QueryMetrics::NO_DATA;
+	}
 
-	while (std::getline(file, line))
+	// Only measured runs tell exact days from earlier ones: the dense table
+	// answers without finding a row
+	QueryMetrics::Outcome outcome = QueryMetrics::ANSWER_EARLIER;
+	if (stamps && _index.hasDay(day, hint))
+		outcome = QueryMetrics::ANSWER_EXACT;
+	markLooked(stamps);
+
+	// Exact product of the two decimals while it fits in 64 bits
+	if (fixed && (amount.digits == 0 || fixedRate <= static_cast<unsigned long long>(-1) / amount.digits))
 	{
-		// Skip header line
-		if (firstLine)
-		{
-			firstLine = false;
-			continue;
-		}
+		out.to(1).put(date, dateLength).put(" => ").putDecimal(amount.digits, amount.scale, amount.negative)
+			.put(" = ").putDecimal(amount.digits * fixedRate, amount.scale + PriceIndex::FIXED_DECIMALS,
+			amount.negative).put("\n");
+		return outcome;
+	}
+	if (fixed)
+		_index.findClosest(day, rate, hint);
 
-		size_t pipePos = line.find('|');
-		if (pipePos == std::string::npos)
-		{
-			std::cerr << "Error: bad input => " << trim(line) << std::endl;
-			continue;
-		}
+	double result = value * rate;
 
-		std::string date = trim(line.substr(0, pipePos));
-		std::string valueStr = trim(line.substr(pipePos + 1));
+	out.to(1).put(date, dateLength).put(" => ").put(value).put(" = ").put(result).put("\n");
+	return outcome;
+}
 
-		// Validate date
-		if (!isValidDate(date))
-		{
-			std::cerr << "Error: bad input => " << date << std::endl;
-			continue;
-		}
+void BitcoinExchange::lookup(Query* queries, size_t count) const
+{
+	size_t hint = 0;
 
-		// Validate value
-		double value;
-		if (!isValidValue(valueStr, value))
-		{
-			std::cerr << "Error: bad input => " << date << std::endl;
-			continue;
-		}
+	for (size_t i = 0; i < count; ++i)
+	{
+		Query& query = queries[i];
 
-		// Check if value is negative
-		if (value < 0)
-		{
-			std::cerr << "Error: not a positive number." << std::endl;
-			continue;
-		}
+		query.found = _index.findClosest(query.day, query.rate, hint);
+		if (!query.found)
+			query.rate = 0;
+		query.result = query.amount * query.rate;
+	}
+}
 
-		// Check if value is too large
-		if (value > 1000)
-		{
-			std::cerr << "Error: too large a number." << std::endl;
-			continue;
-		}
+// Day number of a "YYYY-MM-DD" date, as used by Query::day
+bool BitcoinExchange::dayNumber(const std::string& date, unsigned int& day)
+{
+	return parseDate(date.data(), date.size(), day);
+}
+
+// Line-aligned slices of the input, handed to worker threads in order and
+// written out in order. Workers stay at most a window of chunks ahead of
+// the writer, so only that much output is held in memory.
+struct BitcoinExchange::ChunkQueue
+{
+	struct Chunk
+	{
+		const char* data;
+		size_t size;
+		CapturedOutput* output;
+		bool done;
+	};
+
+	const BitcoinExchange* exchange;
+	QueryMetrics* metrics;
+	std::vector<Chunk> chunks;
+	size_t next;
+	size_t written;
+	size_t window;
+	pthread_mutex_t mutex;
+	pthread_cond_t changed;
+
+	static void* work(void* arg)
+	{
+		ChunkQueue& queue = *static_cast<ChunkQueue*>(arg);
+		QueryMetrics metrics;
 
-		// Find the exchange rate
-		std::string closestDate = findClosestDate(date);
-		if (closestDate.empty())
+		pthread_mutex_lock(&queue.mutex);
+		while (true)
 		{
-			std::cerr << "Error: no data available for date => " << date << std::endl;
-			continue;
+			while (queue.next < queue.chunks.size() && queue.next >= queue.written + queue.window)
+				pthread_cond_wait(&queue.changed, &queue.mutex);
+			if (queue.next == queue.chunks.size())
+				break;
+			Chunk& chunk = queue.chunks[queue.next++];
+			pthread_mutex_unlock(&queue.mutex);
+
+			CapturedOutput* output = new CapturedOutput;
+			queue.exchange->processLines(chunk.data, chunk.size, *output, queue.metrics ? &metrics : NULL);
+
+			pthread_mutex_lock(&queue.mutex);
+			chunk.output = output;
+			chunk.done = true;
+			pthread_cond_broadcast(&queue.changed);
 		}
+		if (queue.metrics)
+			queue.metrics->add(metrics);
+		pthread_mutex_unlock(&queue.mutex);
+		return NULL;
+	}
+};
 
-		double rate = _data[closestDate];
-		double result = value * rate;
+void BitcoinExchange::processInputFile(const std::string& filename, QueryMetrics* metrics)
+{
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		std::cerr << "Error: could not open file." << std::endl;
+		return;
+	}
+	file.load();
+
+	// Skip header line
+	const char* data = file.data();
+	const char* end = data + file.size();
+	const char* header = static_cast<const char*>(std::memchr(data, '\n', file.size()));
+	const char* body = header ? header + 1 : end;
+	size_t size = end - body;
 
-		std::cout << date << " => " << value << " = " << result << std::endl;
+	OutputBuffer out;
+	if (_threads <= 1 || size < CHUNK_SIZE)
+	{
+		processLines(body, size, out, metrics);
+		return;
 	}
 
-	file.close();
+	ChunkQueue queue;
+	queue.exchange = this;
+	queue.metrics = metrics;
+	queue.next = 0;
+	queue.written = 0;
+	queue.window = 4 * _threads;
+	for (const char* p = body; p < end; )
+	{
+		const char* cut = static_cast<size_t>(end - p) > CHUNK_SIZE ? p + CHUNK_SIZE : end;
+		const char* newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+		ChunkQueue::Chunk chunk;
+
+		cut = newline ? newline + 1 : end;
+		chunk.data = p;
+		chunk.size = cut - p;
+		chunk.output = NULL;
+		chunk.done = false;
+		queue.chunks.push_back(chunk);
+		p = cut;
+	}
+	pthread_mutex_init(&queue.mutex, NULL);
+	pthread_cond_init(&queue.changed, NULL);
+
+	std::vector<pthread_t> threads;
+	for (size_t i = 0; i < _threads; ++i)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, &ChunkQueue::work, &queue) != 0)
+			break;
+		threads.push_back(thread);
+	}
+	// Without any worker the writer loop below would wait forever; the
+	// calling thread does it all in order instead
+	if (threads.empty())
+	{
+		pthread_cond_destroy(&queue.changed);
+		pthread_mutex_destroy(&queue.mutex);
+		processLines(body, size, out, metrics);
+		return;
+	}
+
+	// Emit chunks in input order as they complete
+	for (size_t i = 0; i < queue.chunks.size(); ++i)
+	{
+		pthread_mutex_lock(&queue.mutex);
+		while (!queue.chunks[i].done)
+			pthread_cond_wait(&queue.changed, &queue.mutex);
+		CapturedOutput* output = queue.chunks[i].output;
+		pthread_mutex_unlock(&queue.mutex);
+
+		output->replay(out);
+		delete output;
+
+		pthread_mutex_lock(&queue.mutex);
+		++queue.written;
+		pthread_cond_broadcast(&queue.changed);
+		pthread_mutex_unlock(&queue.mutex);
+	}
+
+	for (size_t i = 0; i < threads.size(); ++i)
+		pthread_join(threads[i], NULL);
+	pthread_cond_destroy(&queue.changed);
+	pthread_mutex_destroy(&queue.mutex);
 }
@@ -2,20 +2,59 @@
 #define BITCOINEXCHANGE_HPP
 
 #include <string>
-#include <map>
+#include <cstddef>
+
+#include "PriceIndex.hpp"
+#include "QueryMetrics.hpp"
+
+class OutputBuffer;
 
 class BitcoinExchange
 {
 private:
-	std::map<std::string, double> _data;
+	PriceIndex _index;
+	bool _denseLookup;
+	bool _fixedPoint;
+	bool _useSnapshot;
+	size_t _threads;
+	
+	// Input bytes per chunk when processing in parallel
+	static const size_t CHUNK_SIZE = 1 << 20;
+	struct ChunkQueue;
+	
+	// Fields are (pointer, length) views into the current line
+	bool parseRate(const char* str, size_t length, double& value) const;
+	void loadRows(const char* data, size_t size);
+	QueryMetrics::Outcome answerLine(const char* line, size_t length, OutputBuffer& out, size_t& hint,
+		double* stamps) const;
 	
-	bool isValidDate(const std::string& date) const;
-	bool isValidValue(const std::string& valueStr, double& value) const;
-	std::string trim(const std::string& str) const;
-	bool parseDate(const std::string& date, int& year, int& month, int& day) const;
-	std::string findClosestDate(const std::string& date) const;
+	// A decimal number as written: digits / 10^scale, exact unless it had
+	// more than 19 significant digits
+	struct Decimal
+	{
+		unsigned long long digits;
+		unsigned int scale;
+		bool negative;
+		bool exact;
+	};
+
+	static void trim(const char* str, size_t& begin, size_t& end);
+	static bool parseDecimal(const char* str, size_t length, Decimal& number);
+	static double toDouble(const Decimal& number, const char* str, size_t length);
+	static bool parseDate(const char* date, size_t length, unsigned int& dayNumber);
 
 public:
+	// One entry of a batch lookup: day and amount in, the rest filled in.
+	// found is false when the database has no day at or before day.
+	struct Query
+	{
+		unsigned int day;
+		double amount;
+		bool found;
+		double rate;
+		double result;
+	};
+
 	// Orthodox Canonical Form
 	BitcoinExchange();
 	BitcoinExchange(const BitcoinExchange& other);
@@ -24,7 +63,22 @@ public:
 
 	// Methods
 	bool loadDatabase(const std::string& filename);
-	void processInputFile(const std::string& filename);
+	void setDenseLookup(bool enabled);
+	void setFixedPoint(bool enabled);
+	void setUseSnapshot(bool enabled);
+	void setThreads(size_t threads);
+	void processInputFile(const std::string& filename, QueryMetrics* metrics);
+
+	// Query lines without a header, whole lines only, answered into out.
+	// metrics, if not NULL, counts outcomes and phase times.
+	void processLines(const char* data, size_t size, OutputBuffer& out, QueryMetrics* metrics) const;
+	
+	// Library use without the text format: resolve queries[0, count) against
+	// the loaded database. Each search starts from the previous answer, so a
+	// batch in date order is a single sweep over the index. The 0..1000
+	// amount rule of input files is not applied here.
+	void lookup(Query* queries, size_t count) const;
+	static bool dayNumber(const std::string& date, unsigned int& day);
 };
 
 #endif
@@ -0,0 +1,82 @@
+#include "MappedFile.hpp"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile() : _fd(-1), _regular(false), _map(MAP_FAILED), _data(NULL), _size(0) {}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+// Open and stat the file; its contents are only touched by load()
+bool MappedFile::open(const std::string& path)
+{
+	close();
+	_fd = ::open(path.c_str(), O_RDONLY);
+	if (_fd < 0)
+		return false;
+	_regular = fstat(_fd, &_info) == 0 && S_ISREG(_info.st_mode);
+	return true;
+}
+
+void MappedFile::load()
+{
+	if (_regular && _info.st_size > 0)
+		_map = mmap(NULL, _info.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+
+	if (_map != MAP_FAILED)
+	{
+		_data = static_cast<const char*>(_map);
+		_size = _info.st_size;
+		return;
+	}
+
+	size_t used = 0;
+	ssize_t r;
+
+	_buffer.resize(1 << 16);
+	while ((r = read(_fd, &_buffer[used], _buffer.size() - used)) > 0)
+	{
+		used += r;
+		if (used == _buffer.size())
+			_buffer.resize(_buffer.size() * 2);
+	}
+	_data = &_buffer[0];
+	_size = used;
+}
+
+void MappedFile::close()
+{
+	if (_map != MAP_FAILED)
+		munmap(_map, _size);
+	if (_fd >= 0)
+		::close(_fd);
+	_fd = -1;
+	_regular = false;
+	_map = MAP_FAILED;
+	_buffer.clear();
+	_data = NULL;
+	_size = 0;
+}
+
+bool MappedFile::isRegular() const
+{
+	return _regular;
+}
+
+const struct stat& MappedFile::info() const
+{
+	return _info;
+}
+
+const char* MappedFile::data() const
+{
+	return _data;
+}
+
+size_t MappedFile::size() const
+{
+	return _size;
+}
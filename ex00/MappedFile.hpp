@@ -0,0 +1,42 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <sys/stat.h>
+
+// Read-only view of a whole file: regular files are memory-mapped, anything
+// that cannot be mapped (pipes, empty files) is read into a buffer instead.
+// The bytes are not terminated.
+class MappedFile
+{
+private:
+	int _fd;
+	struct stat _info;
+	bool _regular;
+	void* _map;
+	std::vector<char> _buffer;
+	const char* _data;
+	size_t _size;
+
+	// Owns the mapping, not copyable
+	MappedFile(const MappedFile& other);
+	MappedFile& operator=(const MappedFile& other);
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Methods
+	bool open(const std::string& path);
+	void load();
+	void close();
+
+	bool isRegular() const;
+	const struct stat& info() const;
+	const char* data() const;
+	size_t size() const;
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "OutputBuffer.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <unistd.h>
+
+namespace
+{
+	// Exact in a double
+	const double g_powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10 };
+
+	// a * 10^(5 - exponent), one rounding step away from the exact value
+	double scaled(double a, int exponent)
+	{
+		return exponent <= 5 ? a * g_powers[5 - exponent] : a / g_powers[exponent - 5];
+	}
+
+	// %g text for six significant digits d scaled by 10^exponent, with
+	// trailing zeros dropped
+	int layoutGeneral(const char* d, int exponent, bool negative, char* text)
+	{
+		int last = 5;
+		while (last > 0 && d[last] == '0')
+			--last;
+
+		char* p = text;
+		if (negative)
+			*p++ = '-';
+		if (exponent >= -4 && exponent < 6)
+		{
+			// Fixed notation, exponent + 1 digits before the point
+			if (exponent < 0)
+			{
+				*p++ = '0';
+				*p++ = '.';
+				for (int i = -1; i > exponent; --i)
+					*p++ = '0';
+				for (int i = 0; i <= last; ++i)
+					*p++ = d[i];
+			}
+			else
+			{
+				for (int i = 0; i <= exponent; ++i)
+					*p++ = d[i];
+				if (last > exponent)
+				{
+					*p++ = '.';
+					for (int i = exponent + 1; i <= last; ++i)
+						*p++ = d[i];
+				}
+			}
+		}
+		else
+		{
+			// Scientific notation, at least two exponent digits
+			*p++ = d[0];
+			if (last > 0)
+			{
+				*p++ = '.';
+				for (int i = 1; i <= last; ++i)
+					*p++ = d[i];
+			}
+			*p++ = 'e';
+			*p++ = exponent < 0 ? '-' : '+';
+			int e = exponent < 0 ? -exponent : exponent;
+			if (e >= 100)
+				*p++ = static_cast<char>('0' + e / 100);
+			*p++ = static_cast<char>('0' + e / 10 % 10);
+			*p++ = static_cast<char>('0' + e % 10);
+		}
+		return static_cast<int>(p - text);
+	}
+
+	// printf's %g for the common case, without the cost of the general
+	// conversion: six significant digits are taken from one scaled product,
+	// which is only trusted when it is clearly away from a rounding tie.
+	// Returns 0 when the value is left to sprintf.
+	int formatGeneral(double value, char* text)
+	{
+		double a = std::fabs(value);
+		if (!(a >= 1e-4 && a < 1e15))
+			return 0;
+
+		int exponent = static_cast<int>(std::floor(std::log10(a)));
+		double r = scaled(a, exponent);
+		if (r < 100000)
+			r = scaled(a, --exponent);
+		else if (r >= 1000000)
+			r = scaled(a, ++exponent);
+		if (r < 99999 || r >= 1000000)
+			return 0;
+
+		double whole = std::floor(r);
+		double fraction = r - whole;
+		if (std::fabs(fraction - 0.5) < 1e-6)
+			return 0;
+		long digits = static_cast<long>(whole) + (fraction > 0.5);
+		if (digits >= 1000000)
+		{
+			digits /= 10;
+			++exponent;
+		}
+		if (digits < 100000)
+			return 0;
+
+		char d[6];
+		for (int i = 5; i >= 0; --i, digits /= 10)
+			d[i] = static_cast<char>('0' + digits % 10);
+		return layoutGeneral(d, exponent, value < 0, text);
+	}
+}
+
+OutputBuffer::OutputBuffer() : _fd(1), _size(0) {}
+
+OutputBuffer::~OutputBuffer()
+{
+	flush();
+}
+
+// Following output goes to fd
+OutputBuffer& OutputBuffer::to(int fd)
+{
+	if (fd != _fd)
+	{
+		flush();
+		_fd = fd;
+	}
+	return *this;
+}
+
+OutputBuffer& OutputBuffer::put(const char* data, size_t size)
+{
+	if (_size + size > CAPACITY)
+	{
+		flush();
+		if (size > CAPACITY)
+		{
+			emit(_fd, data, size);
+			return *this;
+		}
+	}
+	std::memcpy(_buffer + _size, data, size);
+	_size += size;
+	return *this;
+}
+
+OutputBuffer& OutputBuffer::put(const char* str)
+{
+	return put(str, std::strlen(str));
+}
+
+// Same text as std::ostream's default formatting (%g, 6 significant digits)
+OutputBuffer& OutputBuffer::put(double value)
+{
+	char text[32];
+	int length = formatGeneral(value, text);
+
+	if (length == 0)
+		length = std::sprintf(text, "%g", value);
+
+	return put(text, length);
+}
+
+// %g of the exact value digits / 10^scale: six significant digits, the
+// rest rounded half to even as printf does for a value it holds exactly
+OutputBuffer& OutputBuffer::putDecimal(unsigned long long digits, unsigned int scale, bool negative)
+{
+	char all[20];
+	int count = 0;
+	do
+	{
+		all[19 - count++] = static_cast<char>('0' + digits % 10);
+		digits /= 10;
+	}
+	while (digits > 0);
+	const char* s = all + 20 - count;
+
+	char d[6];
+	for (int i = 0; i < 6; ++i)
+		d[i] = i < count ? s[i] : '0';
+	int exponent = s[0] == '0' ? 0 : count - 1 - static_cast<int>(scale);
+	if (count > 6)
+	{
+		bool tail = false;
+		for (int i = 7; i < count; ++i)
+			tail |= s[i] != '0';
+		if (s[6] > '5' || (s[6] == '5' && (tail || (d[5] - '0') % 2 == 1)))
+		{
+			int i = 5;
+			while (i >= 0 && d[i] == '9')
+				d[i--] = '0';
+			if (i < 0)
+			{
+				d[0] = '1';
+				++exponent;
+			}
+			else
+				++d[i];
+		}
+	}
+
+	char text[40];
+	return put(text, layoutGeneral(d, exponent, negative, text));
+}
+
+void OutputBuffer::flush()
+{
+	if (_size > 0)
+		emit(_fd, _buffer, _size);
+	_size = 0;
+}
+
+void OutputBuffer::emit(int fd, const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t written = ::write(fd, data, size);
+		if (written <= 0)
+			break;
+		data += written;
+		size -= written;
+	}
+}
+
+CapturedOutput::CapturedOutput() {}
+
+// Keep the last bytes in memory rather than letting ~OutputBuffer write them
+CapturedOutput::~CapturedOutput()
+{
+	flush();
+}
+
+void CapturedOutput::emit(int fd, const char* data, size_t size)
+{
+	if (_runs.empty() || _runs.back().fd != fd)
+	{
+		Run run;
+		run.fd = fd;
+		run.size = 0;
+		_runs.push_back(run);
+	}
+	_runs.back().size += size;
+	_bytes.insert(_bytes.end(), data, data + size);
+}
+
+void CapturedOutput::replay(OutputBuffer& out)
+{
+	flush();
+
+	const char* data = _bytes.empty() ? NULL : &_bytes[0];
+	for (size_t i = 0; i < _runs.size(); ++i)
+	{
+		out.to(_runs[i].fd).put(data, _runs[i].size);
+		data += _runs[i].size;
+	}
+	_bytes.clear();
+	_runs.clear();
+}
@@ -0,0 +1,65 @@
+#ifndef OUTPUTBUFFER_HPP
+#define OUTPUTBUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Collects output for stdout and stderr in one buffer and writes it with a
+// single system call per buffer-full instead of a flush per line. Switching
+// streams writes out what the other one had pending first, so the two stay
+// in the same relative order as unbuffered output.
+class OutputBuffer
+{
+private:
+	static const size_t CAPACITY = 1 << 16;
+
+	int _fd;
+	size_t _size;
+	char _buffer[CAPACITY];
+
+	// One buffer per output, not copyable
+	OutputBuffer(const OutputBuffer& other);
+	OutputBuffer& operator=(const OutputBuffer& other);
+
+protected:
+	// Where buffered bytes for fd end up; write(2) by default
+	virtual void emit(int fd, const char* data, size_t size);
+
+public:
+	OutputBuffer();
+	virtual ~OutputBuffer();
+
+	// Methods
+	OutputBuffer& to(int fd);
+	OutputBuffer& put(const char* data, size_t size);
+	OutputBuffer& put(const char* str);
+	OutputBuffer& put(double value);
+	OutputBuffer& putDecimal(unsigned long long digits, unsigned int scale, bool negative);
+	void flush();
+};
+
+// Output kept in memory, as runs of bytes per stream, to be replayed later
+// through another OutputBuffer in the order it was produced
+class CapturedOutput : public OutputBuffer
+{
+private:
+	struct Run
+	{
+		int fd;
+		size_t size;
+	};
+
+	std::vector<char> _bytes;
+	std::vector<Run> _runs;
+
+protected:
+	void emit(int fd, const char* data, size_t size);
+
+public:
+	CapturedOutput();
+	~CapturedOutput();
+
+	void replay(OutputBuffer& out);
+};
+
+#endif
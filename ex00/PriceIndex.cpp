@@ -0,0 +1,240 @@
+#include "PriceIndex.hpp"
+#include <algorithm>
+
+namespace
+{
+	struct Row
+	{
+		unsigned int day;
+		size_t order;
+		double rate;
+	};
+
+	bool earlier(const Row& a, const Row& b)
+	{
+		return a.day < b.day || (a.day == b.day && a.order < b.order);
+	}
+}
+
+// Orthodox Canonical Form
+PriceIndex::PriceIndex() {}
+
+PriceIndex::PriceIndex(const PriceIndex& other)
+	: _days(other._days), _rates(other._rates), _dense(other._dense), _fixed(other._fixed) {}
+
+PriceIndex& PriceIndex::operator=(const PriceIndex& other)
+{
+	if (this != &other)
+	{
+		_days = other._days;
+		_rates = other._rates;
+		_dense = other._dense;
+		_fixed = other._fixed;
+	}
+	return *this;
+}
+
+PriceIndex::~PriceIndex() {}
+
+void PriceIndex::add(unsigned int day, double rate)
+{
+	_dense.clear();
+	_fixed.clear();
+	_days.push_back(day);
+	_rates.push_back(rate);
+}
+
+// Sort by day and drop all but the last rate of each day
+void PriceIndex::build()
+{
+	bool sorted = true;
+	for (size_t i = 1; i < _days.size(); ++i)
+	{
+		if (_days[i] <= _days[i - 1])
+		{
+			sorted = false;
+			break;
+		}
+	}
+	if (sorted)
+		return;
+
+	std::vector<Row> rows(_days.size());
+	for (size_t i = 0; i < rows.size(); ++i)
+	{
+		rows[i].day = _days[i];
+		rows[i].order = i;
+		rows[i].rate = _rates[i];
+	}
+	std::sort(rows.begin(), rows.end(), earlier);
+
+	_days.clear();
+	_rates.clear();
+	for (size_t i = 0; i < rows.size(); ++i)
+	{
+		if (i + 1 < rows.size() && rows[i + 1].day == rows[i].day)
+			continue;
+		_days.push_back(rows[i].day);
+		_rates.push_back(rows[i].rate);
+	}
+}
+
+// Fill the per-day table, after build(). Spans longer than
+// MAX_DENSE_DAYS are left to the search; returns whether the
+// table was built.
+bool PriceIndex::buildDense()
+{
+	_dense.clear();
+	if (_days.empty() || _days.back() - _days[0] >= MAX_DENSE_DAYS)
+		return false;
+
+	_dense.resize(_days.back() - _days[0] + 1);
+	size_t row = 0;
+	for (size_t slot = 0; slot < _dense.size(); ++slot)
+	{
+		if (row + 1 < _days.size() && _days[row + 1] - _days[0] == slot)
+			++row;
+		_dense[slot] = _rates[row];
+	}
+	return true;
+}
+
+namespace
+{
+	// Last i in [0, n) with days[i] <= day, given days[0] <= day. The range
+	// halves with a conditional move instead of a branch, always taking
+	// log2(n) steps.
+	size_t lastNotAfter(const unsigned int* days, size_t n, unsigned int day)
+	{
+		const unsigned int* base = days;
+
+		while (n > 1)
+		{
+			size_t half = n / 2;
+			base = (base[half] <= day) ? base + half : base;
+			n -= half;
+		}
+		return base - days;
+	}
+}
+
+// Row of the last day at or before day, which must not precede _days[0],
+// searching from row hint. Forward of hint the search gallops in steps of
+// 1, 2, 4... until it passes day, so nearby days cost a few comparisons
+// and a jump of d rows costs O(log d). A day before hint says nothing
+// about where it lies, so [0, hint) is searched without it. Either way the
+// last bracket is bisected branch-free.
+size_t PriceIndex::seek(unsigned int day, size_t hint) const
+{
+	size_t n = _days.size();
+	size_t lo = hint < n ? hint : n - 1;
+	size_t hi;
+	size_t step = 1;
+
+	if (_days[lo] > day)
+		return lastNotAfter(&_days[0], lo, day);
+
+	// Bracket day with _days[lo] <= day and (hi == n or _days[hi] > day)
+	hi = lo + 1;
+	while (hi < n && _days[hi] <= day)
+	{
+		lo = hi;
+		step *= 2;
+		hi = (n - lo > step) ? lo + step : n;
+	}
+	// In-order queries mostly stop on the first step
+	if (hi - lo == 1)
+		return lo;
+	return lo + lastNotAfter(&_days[lo], hi - lo, day);
+}
+
+// Rate of the latest day not after day; false if every day is later.
+// The row found is left in hint as the starting point of the next search.
+bool PriceIndex::findClosest(unsigned int day, double& rate, size_t& hint) const
+{
+	if (_days.empty() || day < _days[0])
+		return false;
+	if (!_dense.empty())
+	{
+		rate = day - _days[0] < _dense.size() ? _dense[day - _days[0]] : _rates.back();
+		return true;
+	}
+	hint = seek(day, hint);
+	rate = _rates[hint];
+	return true;
+}
+
+// Rates as integers in units of 10^-FIXED_DECIMALS, after build(). Each
+// must come back as the same double when divided out again, as rates
+// written with at most FIXED_DECIMALS decimals do; otherwise there is no
+// fixed table.
+bool PriceIndex::buildFixed()
+{
+	static const double UNIT = 1e8;
+	static const double LIMIT = 9007199254740992.0;	// 2^53
+
+	_fixed.clear();
+	std::vector<unsigned long long> fixed(_rates.size());
+	for (size_t i = 0; i < _rates.size(); ++i)
+	{
+		double scaled = _rates[i] * UNIT;
+		if (!(scaled >= 0 && scaled < LIMIT))
+			return false;
+		fixed[i] = static_cast<unsigned long long>(scaled + 0.5);
+		if (static_cast<double>(fixed[i]) / UNIT != _rates[i])
+			return false;
+	}
+	_fixed.swap(fixed);
+	return true;
+}
+
+bool PriceIndex::hasFixed() const
+{
+	return !_fixed.empty();
+}
+
+// The fixed-point rate of the closest earlier day, searching from hint
+bool PriceIndex::findClosestFixed(unsigned int day, unsigned long long& rate, size_t& hint) const
+{
+	if (_fixed.empty() || day < _days[0])
+		return false;
+	hint = seek(day, hint);
+	rate = _fixed[hint];
+	return true;
+}
+
+// Whether day has a row of its own rather than an earlier one standing in,
+// for a day a lookup has already found; hint ends on the row in effect
+bool PriceIndex::hasDay(unsigned int day, size_t& hint) const
+{
+	hint = seek(day, hint);
+	return _days[hint] == day;
+}
+
+size_t PriceIndex::size() const
+{
+	return _days.size();
+}
+
+bool PriceIndex::empty() const
+{
+	return _days.empty();
+}
+
+const unsigned int* PriceIndex::days() const
+{
+	return _days.empty() ? NULL : &_days[0];
+}
+
+const double* PriceIndex::rates() const
+{
+	return _rates.empty() ? NULL : &_rates[0];
+}
+
+void PriceIndex::assign(const unsigned int* days, const double* rates, size_t count)
+{
+	_days.assign(days, days + count);
+	_rates.assign(rates, rates + count);
+	_dense.clear();
+	_fixed.clear();
+}
@@ -0,0 +1,54 @@
+#ifndef PRICEINDEX_HPP
+#define PRICEINDEX_HPP
+
+#include <vector>
+#include <cstddef>
+
+// Exchange rates keyed by day number, kept as two parallel arrays sorted by
+// day so a lookup only touches a contiguous column of 4-byte keys.
+// Rows are collected with add() and ordered once by build(); a day given
+// more than once keeps the rate that was added last.
+// buildDense() adds a table with one slot per day from the first to the
+// last known day, so any query inside that span is a single load.
+// buildFixed() adds the rates as scaled integers for exact arithmetic.
+class PriceIndex
+{
+private:
+	std::vector<unsigned int> _days;
+	std::vector<double> _rates;
+	std::vector<double> _dense;	// rate in effect on each day since _days[0]
+	std::vector<unsigned long long> _fixed;	// _rates in units of 10^-FIXED_DECIMALS
+
+	size_t seek(unsigned int day, size_t hint) const;
+
+public:
+	// Largest span of days buildDense() will cover (8 bytes per day)
+	static const unsigned int MAX_DENSE_DAYS = 1u << 20;
+	// Decimal places of the fixed-point rates
+	static const unsigned int FIXED_DECIMALS = 8;
+
+	// Orthodox Canonical Form
+	PriceIndex();
+	PriceIndex(const PriceIndex& other);
+	PriceIndex& operator=(const PriceIndex& other);
+	~PriceIndex();
+
+	// Methods
+	void add(unsigned int day, double rate);
+	void build();
+	bool buildDense();
+	bool findClosest(unsigned int day, double& rate, size_t& hint) const;
+	bool buildFixed();
+	bool hasFixed() const;
+	bool findClosestFixed(unsigned int day, unsigned long long& rate, size_t& hint) const;
+	bool hasDay(unsigned int day, size_t& hint) const;
+	size_t size() const;
+	bool empty() const;
+	
+	// Rows in day order, after build(); assign() takes rows already in that form
+	const unsigned int* days() const;
+	const double* rates() const;
+	void assign(const unsigned int* days, const double* rates, size_t count);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "QueryMetrics.hpp"
+#include <ctime>
+
+// Orthodox Canonical Form
+QueryMetrics::QueryMetrics()
+	: _started(now()), _lines(0), _exact(0), _earlier(0), _badInput(0), _notPositive(0),
+	  _tooLarge(0), _noData(0), _parseTime(0), _lookupTime(0), _outputTime(0) {}
+
+QueryMetrics::QueryMetrics(const QueryMetrics& other)
+	: _started(other._started), _lines(other._lines), _exact(other._exact), _earlier(other._earlier),
+	  _badInput(other._badInput), _notPositive(other._notPositive), _tooLarge(other._tooLarge),
+	  _noData(other._noData), _parseTime(other._parseTime), _lookupTime(other._lookupTime),
+	  _outputTime(other._outputTime) {}
+
+QueryMetrics& QueryMetrics::operator=(const QueryMetrics& other)
+{
+	if (this != &other)
+	{
+		_started = other._started;
+		_lines = other._lines;
+		_exact = other._exact;
+		_earlier = other._earlier;
+		_badInput = other._badInput;
+		_notPositive = other._notPositive;
+		_tooLarge = other._tooLarge;
+		_noData = other._noData;
+		_parseTime = other._parseTime;
+		_lookupTime = other._lookupTime;
+		_outputTime = other._outputTime;
+	}
+	return *this;
+}
+
+QueryMetrics::~QueryMetrics() {}
+
+// Methods
+
+void QueryMetrics::record(Outcome outcome, double parse, double lookup, double output)
+{
+	++_lines;
+	switch (outcome)
+	{
+		case ANSWER_EXACT: ++_exact; break;
+		case ANSWER_EARLIER: ++_earlier; break;
+		case BAD_INPUT: ++_badInput; break;
+		case NOT_POSITIVE: ++_notPositive; break;
+		case TOO_LARGE: ++_tooLarge; break;
+		case NO_DATA: ++_noData; break;
+	}
+	_parseTime += parse;
+	_lookupTime += lookup;
+	_outputTime += output;
+}
+
+// Fold in the counts of another run (a worker's or a client's); the
+// elapsed time stays this one's
+void QueryMetrics::add(const QueryMetrics& other)
+{
+	_lines += other._lines;
+	_exact += other._exact;
+	_earlier += other._earlier;
+	_badInput += other._badInput;
+	_notPositive += other._notPositive;
+	_tooLarge += other._tooLarge;
+	_noData += other._noData;
+	_parseTime += other._parseTime;
+	_lookupTime += other._lookupTime;
+	_outputTime += other._outputTime;
+}
+
+unsigned long QueryMetrics::lines() const
+{
+	return _lines;
+}
+
+void QueryMetrics::writeJson(std::ostream& os) const
+{
+	double elapsed = now() - _started;
+	std::streamsize precision = os.precision(6);
+	std::ios_base::fmtflags flags = os.setf(std::ios_base::fixed, std::ios_base::floatfield);
+
+	os << "{\"elapsed_s\":" << elapsed
+		<< ",\"lines\":" << _lines
+		<< ",\"lines_per_s\":" << (elapsed > 0 ? _lines / elapsed : 0.0)
+		<< ",\"time_s\":{\"parse\":" << _parseTime << ",\"lookup\":" << _lookupTime
+		<< ",\"output\":" << _outputTime << "}"
+		<< ",\"errors\":{\"bad_input\":" << _badInput << ",\"not_positive\":" << _notPositive
+		<< ",\"too_large\":" << _tooLarge << ",\"no_data\":" << _noData << "}"
+		<< ",\"lookups\":{\"exact\":" << _exact << ",\"earlier\":" << _earlier << "}}\n";
+	os.flush();
+	os.flags(flags);
+	os.precision(precision);
+}
+
+double QueryMetrics::now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
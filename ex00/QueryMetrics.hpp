@@ -0,0 +1,57 @@
+#ifndef QUERYMETRICS_HPP
+#define QUERYMETRICS_HPP
+
+#include <ostream>
+
+// Counters for a run of query lines, filled in by processLines when it is
+// handed one; without one the only cost is a branch per line. Each line is
+// split into parse (splitting and validation), lookup and output time.
+// With several workers the phase times are summed over them, while the
+// elapsed time runs from construction.
+class QueryMetrics
+{
+public:
+	// What became of one line
+	enum Outcome
+	{
+		ANSWER_EXACT,	// the database has the day itself
+		ANSWER_EARLIER,	// the closest earlier day stood in
+		BAD_INPUT,
+		NOT_POSITIVE,
+		TOO_LARGE,
+		NO_DATA
+	};
+
+private:
+	double _started;
+	unsigned long _lines;
+	unsigned long _exact;
+	unsigned long _earlier;
+	unsigned long _badInput;
+	unsigned long _notPositive;
+	unsigned long _tooLarge;
+	unsigned long _noData;
+	double _parseTime;
+	double _lookupTime;
+	double _outputTime;
+
+public:
+	// Orthodox Canonical Form
+	QueryMetrics();
+	QueryMetrics(const QueryMetrics& other);
+	QueryMetrics& operator=(const QueryMetrics& other);
+	~QueryMetrics();
+
+	// Methods
+	void record(Outcome outcome, double parse, double lookup, double output);
+	void add(const QueryMetrics& other);
+	unsigned long lines() const;
+
+	// One JSON object on one line, so periodic reports form JSON Lines
+	void writeJson(std::ostream& os) const;
+
+	// Monotonic clock in seconds
+	static double now();
+};
+
+#endif
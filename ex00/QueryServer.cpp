@@ -0,0 +1,388 @@
+#include "QueryServer.hpp"
+#include "OutputBuffer.hpp"
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace
+{
+	// Set by SIGHUP, picked up by the watcher thread
+	volatile sig_atomic_t hangupPending = 0;
+
+	void onHangup(int)
+	{
+		hangupPending = 1;
+	}
+
+	// How often the watcher looks at the signal flag and the database file
+	const long WATCH_INTERVAL_NS = 250000000L;
+
+	const char HEADER[] = "date | value";
+
+	// Everything written for a client goes back over its socket, results
+	// and error lines alike
+	class SocketOutput : public OutputBuffer
+	{
+	private:
+		int _socket;
+
+	protected:
+		void emit(int, const char* data, size_t size)
+		{
+			while (size > 0)
+			{
+				ssize_t written = ::write(_socket, data, size);
+				if (written <= 0)
+					break;
+				data += written;
+				size -= written;
+			}
+		}
+
+	public:
+		SocketOutput(int socket) : _socket(socket) {}
+
+		// Flush here, while emit still goes to the socket
+		~SocketOutput()
+		{
+			flush();
+		}
+	};
+}
+
+QueryServer::QueryServer(const BitcoinExchange& settings, const std::string& database)
+	: _settings(settings), _database(database), _current(NULL), _stopping(false), _watching(false),
+	  _metrics(NULL), _report(NULL), _reportInterval(0)
+{
+	pthread_mutex_init(&_mutex, NULL);
+}
+
+QueryServer::~QueryServer()
+{
+	stop();
+	if (_current)
+		release(_current);
+	pthread_mutex_destroy(&_mutex);
+}
+
+// Helper functions
+
+// Identity of the database file as far as reloading is concerned: a new
+// size, modification time or inode (replaced by rename) means new data.
+// The time is taken to the nanosecond, as the snapshot check does, so an
+// in-place rewrite within the same second is still seen
+QueryServer::FileStamp QueryServer::stampOf(const std::string& path)
+{
+	FileStamp stamp;
+	struct stat info;
+
+	std::memset(&stamp, 0, sizeof(stamp));
+	stamp.exists = ::stat(path.c_str(), &info) == 0;
+	if (!stamp.exists)
+		return stamp;
+	stamp.size = info.st_size;
+#ifdef __APPLE__
+	stamp.mtime = info.st_mtimespec.tv_sec;
+	stamp.mtimeNsec = info.st_mtimespec.tv_nsec;
+#else
+	stamp.mtime = info.st_mtim.tv_sec;
+	stamp.mtimeNsec = info.st_mtim.tv_nsec;
+#endif
+	stamp.inode = info.st_ino;
+	return stamp;
+}
+
+// Pin the current generation; the lock covers only the count
+QueryServer::Generation* QueryServer::acquire()
+{
+	pthread_mutex_lock(&_mutex);
+	Generation* generation = _current;
+	++generation->refs;
+	pthread_mutex_unlock(&_mutex);
+	return generation;
+}
+
+void QueryServer::release(Generation* generation)
+{
+	pthread_mutex_lock(&_mutex);
+	bool last = --generation->refs == 0;
+	pthread_mutex_unlock(&_mutex);
+	if (last)
+		delete generation;
+}
+
+// Load the database into a new generation and make it current. A failed
+// load keeps the old one serving.
+bool QueryServer::reload()
+{
+	Generation* next = new Generation;
+
+	_stamp = stampOf(_database);
+	next->exchange = _settings;
+	next->refs = 1;
+	if (!next->exchange.loadDatabase(_database))
+	{
+		delete next;
+		return false;
+	}
+
+	pthread_mutex_lock(&_mutex);
+	Generation* previous = _current;
+	_current = next;
+	pthread_mutex_unlock(&_mutex);
+
+	if (previous)
+		release(previous);
+	return true;
+}
+
+// Answer whole lines as they arrive, one generation per batch of lines
+// read, and flush before waiting for more. A first line equal to the
+// input file header is skipped, so an input file can be piped in as is.
+void QueryServer::serveStream(int fd, OutputBuffer& out)
+{
+	std::vector<char> pending;
+	char block[1 << 16];
+	bool first = true;
+	bool open = true;
+	QueryMetrics batch;
+
+	while (open)
+	{
+		ssize_t got = ::read(fd, block, sizeof(block));
+		if (got < 0 && errno == EINTR)
+			continue;
+
+		size_t whole;
+		if (got > 0)
+		{
+			size_t before = pending.size();
+			pending.insert(pending.end(), block, block + got);
+
+			// Only the new bytes can hold the last newline
+			whole = pending.size();
+			while (whole > before && pending[whole - 1] != '\n')
+				--whole;
+			if (whole == before)
+				continue;
+		}
+		else
+		{
+			open = false;
+			whole = pending.size();
+			if (whole == 0)
+				break;
+		}
+
+		const char* data = &pending[0];
+		size_t size = whole;
+		if (first)
+		{
+			const char* newline = static_cast<const char*>(std::memchr(data, '\n', size));
+			size_t length = (newline ? newline : data + size) - data;
+
+			if (length > 0 && data[length - 1] == '\r')
+				--length;
+			if (length == sizeof(HEADER) - 1 && std::memcmp(data, HEADER, length) == 0)
+			{
+				size_t skip = newline ? newline + 1 - data : size;
+				data += skip;
+				size -= skip;
+			}
+			first = false;
+		}
+
+		Generation* generation = acquire();
+		generation->exchange.processLines(data, size, out, _metrics ? &batch : NULL);
+		release(generation);
+		out.flush();
+
+		if (_metrics)
+		{
+			pthread_mutex_lock(&_mutex);
+			_metrics->add(batch);
+			pthread_mutex_unlock(&_mutex);
+			batch = QueryMetrics();
+		}
+
+		pending.erase(pending.begin(), pending.begin() + whole);
+	}
+	out.flush();
+}
+
+// Polls for SIGHUP and for changes to the database file until stopped
+void* QueryServer::watchMain(void* arg)
+{
+	QueryServer& server = *static_cast<QueryServer*>(arg);
+	double reported = QueryMetrics::now();
+
+	while (true)
+	{
+		struct timespec pause;
+		pause.tv_sec = 0;
+		pause.tv_nsec = WATCH_INTERVAL_NS;
+		nanosleep(&pause, NULL);
+
+		pthread_mutex_lock(&server._mutex);
+		bool stopping = server._stopping;
+		pthread_mutex_unlock(&server._mutex);
+		if (stopping)
+			break;
+
+		bool hangup = hangupPending != 0;
+		hangupPending = 0;
+
+		FileStamp stamp = stampOf(server._database);
+		bool changed = stamp.exists != server._stamp.exists || stamp.size != server._stamp.size
+			|| stamp.mtime != server._stamp.mtime || stamp.mtimeNsec != server._stamp.mtimeNsec
+			|| stamp.inode != server._stamp.inode;
+
+		// A file in the middle of being replaced may be missing for a moment
+		if (hangup || (changed && stamp.exists))
+			server.reload();
+		else if (changed)
+			server._stamp = stamp;
+
+		if (server._reportInterval > 0 && QueryMetrics::now() - reported >= server._reportInterval)
+		{
+			server.reportMetrics();
+			reported = QueryMetrics::now();
+		}
+	}
+	return NULL;
+}
+
+void* QueryServer::clientMain(void* arg)
+{
+	Client* client = static_cast<Client*>(arg);
+
+	{
+		SocketOutput out(client->fd);
+		client->server->serveStream(client->fd, out);
+	}
+	::close(client->fd);
+	delete client;
+	return NULL;
+}
+
+// Methods
+
+// First load, signal setup and the watcher thread
+bool QueryServer::start()
+{
+	if (!reload())
+		return false;
+
+	struct sigaction action;
+	std::memset(&action, 0, sizeof(action));
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	action.sa_handler = &onHangup;
+	sigaction(SIGHUP, &action, NULL);
+
+	// A client hanging up mid-answer must not end the server
+	action.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &action, NULL);
+
+	_stopping = false;
+	_watching = pthread_create(&_watcher, NULL, &QueryServer::watchMain, this) == 0;
+	return true;
+}
+
+// Count every client's lines into metrics; with interval > 0 the watcher
+// writes a report to report that often. Set before start().
+void QueryServer::setMetrics(QueryMetrics* metrics, std::ostream* report, double interval)
+{
+	_metrics = metrics;
+	_report = report;
+	_reportInterval = metrics && report ? interval : 0;
+}
+
+// A report of the counts so far; the lock is held only for the copy
+void QueryServer::reportMetrics()
+{
+	if (!_metrics || !_report)
+		return;
+	pthread_mutex_lock(&_mutex);
+	QueryMetrics snapshot = *_metrics;
+	pthread_mutex_unlock(&_mutex);
+	snapshot.writeJson(*_report);
+}
+
+void QueryServer::stop()
+{
+	if (!_watching)
+		return;
+	pthread_mutex_lock(&_mutex);
+	_stopping = true;
+	pthread_mutex_unlock(&_mutex);
+	pthread_join(_watcher, NULL);
+	_watching = false;
+}
+
+// Queries on stdin, answers and errors on stdout and stderr, until EOF
+void QueryServer::serveStdin()
+{
+	OutputBuffer out;
+	serveStream(0, out);
+}
+
+// Accept clients on a Unix stream socket, each served on its own thread.
+// Returns only if the socket cannot be set up or accepting fails.
+bool QueryServer::serveSocket(const std::string& path)
+{
+	struct sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Error: socket path too long." << std::endl;
+		return false;
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	::unlink(path.c_str());
+	if (listener < 0 || ::bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0
+		|| ::listen(listener, SOMAXCONN) < 0)
+	{
+		std::cerr << "Error: could not listen on " << path << "." << std::endl;
+		if (listener >= 0)
+			::close(listener);
+		return false;
+	}
+
+	while (true)
+	{
+		int fd = ::accept(listener, NULL, NULL);
+		if (fd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+
+		Client* client = new Client;
+		pthread_t thread;
+		client->server = this;
+		client->fd = fd;
+		if (pthread_create(&thread, NULL, &QueryServer::clientMain, client) != 0)
+		{
+			::close(fd);
+			delete client;
+			continue;
+		}
+		pthread_detach(thread);
+	}
+
+	std::cerr << "Error: could not accept on " << path << "." << std::endl;
+	::close(listener);
+	::unlink(path.c_str());
+	return false;
+}
@@ -0,0 +1,87 @@
+#ifndef QUERYSERVER_HPP
+#define QUERYSERVER_HPP
+
+#include "BitcoinExchange.hpp"
+#include "QueryMetrics.hpp"
+#include <string>
+#include <ostream>
+#include <cstddef>
+#include <ctime>
+#include <pthread.h>
+#include <sys/types.h>
+
+class OutputBuffer;
+
+// Resident btc: loads the database once and answers query lines from stdin
+// or from clients of a Unix socket as they arrive.
+// The loaded database is a generation that readers pin with a reference
+// count for the time of one batch of lines. A reload (SIGHUP, or the CSV
+// changing on disk) builds the next generation off to the side and swaps
+// the pointer, so queries never wait for a parse; the old generation goes
+// away with its last reader.
+// With metrics set, every client's lines are counted there, and the
+// watcher writes a report every interval seconds.
+class QueryServer
+{
+private:
+	struct Generation
+	{
+		BitcoinExchange exchange;
+		size_t refs;
+	};
+
+	struct FileStamp
+	{
+		off_t size;
+		time_t mtime;
+		long mtimeNsec;
+		ino_t inode;
+		bool exists;
+	};
+
+	struct Client
+	{
+		QueryServer* server;
+		int fd;
+	};
+
+	BitcoinExchange _settings;
+	std::string _database;
+	Generation* _current;
+	FileStamp _stamp;
+	bool _stopping;
+	pthread_mutex_t _mutex;
+	pthread_t _watcher;
+	bool _watching;
+	QueryMetrics* _metrics;
+	std::ostream* _report;
+	double _reportInterval;
+
+	// Owns threads and generations, not copyable
+	QueryServer(const QueryServer& other);
+	QueryServer& operator=(const QueryServer& other);
+
+	Generation* acquire();
+	void release(Generation* generation);
+	bool reload();
+	void serveStream(int fd, OutputBuffer& out);
+
+	static FileStamp stampOf(const std::string& path);
+	static void* watchMain(void* arg);
+	static void* clientMain(void* arg);
+
+public:
+	// settings carries the lookup options; the database is loaded by start()
+	QueryServer(const BitcoinExchange& settings, const std::string& database);
+	~QueryServer();
+
+	// Methods
+	bool start();
+	void setMetrics(QueryMetrics* metrics, std::ostream* report, double interval);
+	void reportMetrics();
+	void stop();
+	void serveStdin();
+	bool serveSocket(const std::string& path);
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "Snapshot.hpp"
+#include <cstring>
+#include <cstdio>
+#include <sstream>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+	const char MAGIC[8] = { 'B', 'T', 'C', 'S', 'N', 'A', 'P', '\0' };
+	const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+	struct Header
+	{
+		char magic[8];
+		unsigned int version;
+		unsigned int byteOrder;
+		unsigned long long count;
+		unsigned long long csvSize;
+		long long csvSeconds;
+		long long csvNanoseconds;
+		unsigned int checksum;
+		unsigned int reserved;
+	};
+
+	size_t padded(size_t bytes)
+	{
+		return (bytes + 7) / 8 * 8;
+	}
+
+	size_t fileSize(size_t count)
+	{
+		return sizeof(Header) + padded(count * sizeof(unsigned int)) + count * sizeof(double);
+	}
+
+	// FNV-1a over the rows
+	unsigned int checksum(const unsigned int* days, const double* rates, size_t count)
+	{
+		unsigned int hash = 2166136261u;
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(days);
+
+		for (size_t i = 0; i < count * sizeof(unsigned int); ++i)
+			hash = (hash ^ bytes[i]) * 16777619u;
+		bytes = reinterpret_cast<const unsigned char*>(rates);
+		for (size_t i = 0; i < count * sizeof(double); ++i)
+			hash = (hash ^ bytes[i]) * 16777619u;
+		return hash;
+	}
+
+	void describe(Header& header, const struct stat& csv, size_t count)
+	{
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = Snapshot::VERSION;
+		header.byteOrder = BYTE_ORDER_MARK;
+		header.count = count;
+		header.csvSize = csv.st_size;
+#ifdef __APPLE__
+		header.csvSeconds = csv.st_mtimespec.tv_sec;
+		header.csvNanoseconds = csv.st_mtimespec.tv_nsec;
+#else
+		header.csvSeconds = csv.st_mtim.tv_sec;
+		header.csvNanoseconds = csv.st_mtim.tv_nsec;
+#endif
+	}
+}
+
+std::string Snapshot::pathFor(const std::string& csvPath)
+{
+	return csvPath + ".snap";
+}
+
+bool Snapshot::load(const std::string& path, const struct stat& csv, PriceIndex& index)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	void* map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+		&& static_cast<size_t>(st.st_size) >= sizeof(Header))
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	const char* data = static_cast<const char*>(map);
+	Header expected;
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	describe(expected, csv, static_cast<size_t>(header.count));
+	expected.checksum = header.checksum;
+
+	bool ok = std::memcmp(&header, &expected, sizeof(header)) == 0
+		&& header.count <= (static_cast<size_t>(st.st_size) - sizeof(Header)) / sizeof(double)
+		&& static_cast<size_t>(st.st_size) == fileSize(static_cast<size_t>(header.count));
+	if (ok)
+	{
+		size_t count = static_cast<size_t>(header.count);
+		const unsigned int* days = reinterpret_cast<const unsigned int*>(data + sizeof(Header));
+		const double* rates = reinterpret_cast<const double*>(
+			data + sizeof(Header) + padded(count * sizeof(unsigned int)));
+
+		ok = checksum(days, rates, count) == header.checksum;
+		if (ok)
+			index.assign(days, rates, count);
+	}
+	munmap(map, st.st_size);
+	return ok;
+}
+
+bool Snapshot::save(const std::string& path, const struct stat& csv, const PriceIndex& index)
+{
+	size_t count = index.size();
+	Header header;
+	describe(header, csv, count);
+	header.checksum = checksum(index.days(), index.rates(), count);
+
+	std::ostringstream temporary;
+	temporary << path << ".tmp" << getpid();
+	std::string tmpPath = temporary.str();
+
+	int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+
+	const char zeros[8] = { 0 };
+	size_t daysBytes = count * sizeof(unsigned int);
+	bool ok = write(fd, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header))
+		&& write(fd, index.days(), daysBytes) == static_cast<ssize_t>(daysBytes)
+		&& write(fd, zeros, padded(daysBytes) - daysBytes) == static_cast<ssize_t>(padded(daysBytes) - daysBytes)
+		&& write(fd, index.rates(), count * sizeof(double)) == static_cast<ssize_t>(count * sizeof(double));
+	ok = (close(fd) == 0) && ok;
+
+	if (ok && std::rename(tmpPath.c_str(), path.c_str()) == 0)
+		return true;
+	std::remove(tmpPath.c_str());
+	return false;
+}
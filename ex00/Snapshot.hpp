@@ -0,0 +1,32 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <string>
+#include <sys/stat.h>
+
+#include "PriceIndex.hpp"
+
+// Binary copy of a built PriceIndex, stored next to the CSV it came from.
+// The header records the CSV's size and modification time and a checksum
+// of the rows, so a snapshot is only used while it still matches the CSV
+// and was written completely by a machine with the same byte order.
+//
+// Layout, native byte order:
+//   header (magic, version, count, CSV size and mtime, checksum)
+//   count day numbers (uint32), padded to 8 bytes
+//   count rates (double)
+namespace Snapshot
+{
+	const unsigned int VERSION = 3;
+
+	std::string pathFor(const std::string& csvPath);
+
+	// Fill index from the snapshot if it is intact and matches csv
+	bool load(const std::string& path, const struct stat& csv, PriceIndex& index);
+
+	// Write through a temporary file and rename it, so readers never see
+	// half a snapshot; failures (read-only directory...) are not errors
+	bool save(const std::string& path, const struct stat& csv, const PriceIndex& index);
+}
+
+#endif
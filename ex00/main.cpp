@@ -1,22 +1,149 @@
 #include "BitcoinExchange.hpp"
+#include "QueryServer.hpp"
+#include "QueryMetrics.hpp"
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+
+// Option argument: a positive decimal count
+static bool parseCount(const char* str, size_t& out)
+{
+	char* end;
+	unsigned long value = std::strtoul(str, &end, 10);
+
+	if (*str < '0' || *str > '9' || *end != '\0' || value == 0)
+		return false;
+	out = value;
+	return true;
+}
 
 int main(int argc, char** argv)
 {
-	if (argc != 2)
+	BitcoinExchange exchange;
+	int first = 1;
+	size_t count;
+	bool serve = false;
+	std::string socketPath;
+	std::string metricsPath;
+	size_t metricsInterval = 10;
+
+	// Leading "--" options; the input file follows, except when serving
+	while (first < argc && std::string(argv[first]).compare(0, 2, "--") == 0)
+	{
+		std::string opt(argv[first]);
+
+		if (opt == "--dense")
+			exchange.setDenseLookup(true);
+		else if (opt == "--fixed")
+			exchange.setFixedPoint(true);
+		else if (opt == "--no-snapshot")
+			exchange.setUseSnapshot(false);
+		else if (opt == "--threads")
+		{
+			if (first + 1 >= argc || !parseCount(argv[first + 1], count))
+			{
+				std::cerr << "Error: --threads needs a positive count" << std::endl;
+				return 1;
+			}
+			exchange.setThreads(count);
+			++first;
+		}
+		else if (opt == "--serve")
+			serve = true;
+		else if (opt == "--socket")
+		{
+			if (first + 1 >= argc)
+			{
+				std::cerr << "Error: --socket needs a path" << std::endl;
+				return 1;
+			}
+			socketPath = argv[first + 1];
+			serve = true;
+			++first;
+		}
+		else if (opt == "--metrics")
+		{
+			if (first + 1 >= argc)
+			{
+				std::cerr << "Error: --metrics needs a path (- for stderr)" << std::endl;
+				return 1;
+			}
+			metricsPath = argv[first + 1];
+			++first;
+		}
+		else if (opt == "--metrics-interval")
+		{
+			if (first + 1 >= argc || !parseCount(argv[first + 1], metricsInterval))
+			{
+				std::cerr << "Error: --metrics-interval needs a positive count of seconds" << std::endl;
+				return 1;
+			}
+			++first;
+		}
+		else
+		{
+			std::cerr << "Error: unknown option " << opt << std::endl;
+			return 1;
+		}
+		++first;
+	}
+
+	// Metrics as JSON to a file or stderr: once at the end, and every
+	// interval seconds while serving
+	QueryMetrics metrics;
+	std::ofstream metricsFile;
+	std::ostream* report = NULL;
+	if (metricsPath == "-")
+		report = &std::cerr;
+	else if (!metricsPath.empty())
+	{
+		metricsFile.open(metricsPath.c_str());
+		if (!metricsFile)
+		{
+			std::cerr << "Error: could not open " << metricsPath << "." << std::endl;
+			return 1;
+		}
+		report = &metricsFile;
+	}
+
+	// Resident mode: queries from stdin or socket clients until EOF or kill
+	if (serve)
+	{
+		if (argc != first)
+		{
+			std::cerr << "Error: no input file in server mode." << std::endl;
+			return 1;
+		}
+		QueryServer server(exchange, "data.csv");
+		if (report)
+			server.setMetrics(&metrics, report, metricsInterval);
+		if (!server.start())
+			return 1;
+		if (socketPath.empty())
+			server.serveStdin();
+		else if (!server.serveSocket(socketPath))
+			return 1;
+		server.stop();
+		server.reportMetrics();
+		return 0;
+	}
+
+	if (argc - first != 1)
 	{
 		std::cerr << "Error: could not open file." << std::endl;
 		return 1;
 	}
-
-	BitcoinExchange exchange;
 	
 	// Load the database
 	if (!exchange.loadDatabase("data.csv"))
 		return 1;
 
-	// Process the input file
-	exchange.processInputFile(argv[1]);
+	// Process the input file, timed from here
+	metrics = QueryMetrics();
+	exchange.processInputFile(argv[first], report ? &metrics : NULL);
+	if (report)
+		metrics.writeJson(*report);
 
 	return 0;
 }
@@ -0,0 +1,166 @@
+#include "ColumnOps.hpp"
+#include <climits>
+
+#if !defined(RPN_NO_SIMD) && defined(__AVX2__)
+# define COLUMN_AVX2
+# include <immintrin.h>
+#elif !defined(RPN_NO_SIMD) && defined(__SSE2__)
+# define COLUMN_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Wrapping arithmetic, done in unsigned where overflow is defined
+	inline int wrapAdd(int a, int b)
+	{
+		return static_cast<int>(static_cast<unsigned int>(a) + static_cast<unsigned int>(b));
+	}
+
+	inline int wrapSub(int a, int b)
+	{
+		return static_cast<int>(static_cast<unsigned int>(a) - static_cast<unsigned int>(b));
+	}
+
+	inline int wrapMul(int a, int b)
+	{
+		return static_cast<int>(static_cast<unsigned int>(a) * static_cast<unsigned int>(b));
+	}
+}
+
+#if defined(COLUMN_AVX2)
+
+void ColumnOps::add(int* a, const int* b, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_add_epi32(x, y));
+	}
+	for (; i < n; ++i)
+		a[i] = wrapAdd(a[i], b[i]);
+}
+
+void ColumnOps::sub(int* a, const int* b, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_sub_epi32(x, y));
+	}
+	for (; i < n; ++i)
+		a[i] = wrapSub(a[i], b[i]);
+}
+
+void ColumnOps::mul(int* a, const int* b, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_mullo_epi32(x, y));
+	}
+	for (; i < n; ++i)
+		a[i] = wrapMul(a[i], b[i]);
+}
+
+const char* ColumnOps::kind()
+{
+	return "avx2";
+}
+
+#elif defined(COLUMN_SSE2)
+
+void ColumnOps::add(int* a, const int* b, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), _mm_add_epi32(x, y));
+	}
+	for (; i < n; ++i)
+		a[i] = wrapAdd(a[i], b[i]);
+}
+
+void ColumnOps::sub(int* a, const int* b, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), _mm_sub_epi32(x, y));
+	}
+	for (; i < n; ++i)
+		a[i] = wrapSub(a[i], b[i]);
+}
+
+// SSE2 has no 32-bit low multiply: the even and odd lanes go through the
+// 32x32->64 multiply separately and the low halves are put back together
+void ColumnOps::mul(int* a, const int* b, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		__m128i even = _mm_mul_epu32(x, y);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
+		__m128i product = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+			_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), product);
+	}
+	for (; i < n; ++i)
+		a[i] = wrapMul(a[i], b[i]);
+}
+
+const char* ColumnOps::kind()
+{
+	return "sse2";
+}
+
+#else
+
+void ColumnOps::add(int* a, const int* b, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		a[i] = wrapAdd(a[i], b[i]);
+}
+
+void ColumnOps::sub(int* a, const int* b, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		a[i] = wrapSub(a[i], b[i]);
+}
+
+void ColumnOps::mul(int* a, const int* b, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		a[i] = wrapMul(a[i], b[i]);
+}
+
+const char* ColumnOps::kind()
+{
+	return "scalar";
+}
+
+#endif
+
+// No instruction set divides integers lane-wise, so division stays scalar
+size_t ColumnOps::div(int* a, const int* b, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (b[i] == 0 || (b[i] == -1 && a[i] == INT_MIN))
+			return i;
+		a[i] /= b[i];
+	}
+	return n;
+}
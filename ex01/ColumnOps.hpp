@@ -0,0 +1,25 @@
+#ifndef COLUMNOPS_HPP
+#define COLUMNOPS_HPP
+
+#include <cstddef>
+
+// Element-wise int arithmetic over columns, a[i] = a[i] op b[i] for i in
+// [0, n), for running one RPN program over many rows at once. Results wrap
+// on overflow (two's complement) instead of being undefined. Which
+// instruction set does the work is picked at build time with SIMD= in the
+// Makefile.
+namespace ColumnOps
+{
+	void add(int* a, const int* b, size_t n);
+	void sub(int* a, const int* b, size_t n);
+	void mul(int* a, const int* b, size_t n);
+
+	// Returns the first i with b[i] == 0 or a[i] / b[i] == INT_MIN / -1,
+	// or n when there is none; rows from there on are left as they were.
+	size_t div(int* a, const int* b, size_t n);
+
+	// "avx2", "sse2" or "scalar"
+	const char* kind();
+}
+
+#endif
@@ -1,110 +1,237 @@
 #include "RPN.hpp"
-#include <iostream>
-#include <sstream>
-#include <cstdlib>
+#include <climits>
 #include <stdexcept>
 
+namespace
+{
+	// Character classes for the tokenizer, one table lookup per byte
+	enum
+	{
+		SPACE = 1,
+		DIGIT = 2,
+		SIGN = 4,
+		OPERATOR = 8
+	};
+
+	struct CharClasses
+	{
+		unsigned char of[256];
+
+		CharClasses()
+		{
+			for (int c = 0; c < 256; ++c)
+				of[c] = 0;
+			// The separators std::istream skips in the C locale
+			of[static_cast<unsigned char>(' ')] = SPACE;
+			for (int c = '\t'; c <= '\r'; ++c)
+				of[c] = SPACE;
+			for (int c = '0'; c <= '9'; ++c)
+				of[c] = DIGIT;
+			of[static_cast<unsigned char>('+')] = SIGN | OPERATOR;
+			of[static_cast<unsigned char>('-')] = SIGN | OPERATOR;
+			of[static_cast<unsigned char>('*')] = OPERATOR;
+			of[static_cast<unsigned char>('/')] = OPERATOR;
+		}
+	};
+
+	const CharClasses CLASSES;
+
+	inline unsigned char classOf(char c)
+	{
+		return CLASSES.of[static_cast<unsigned char>(c)];
+	}
+}
+
 // Orthodox Canonical Form
-RPN::RPN() {}
+RPN::RPN() : _stack(64), _checked(false) {}
 
-RPN::RPN(const RPN& other) : _stack(other._stack) {}
+RPN::RPN(const RPN& other) : _stack(other._stack), _columns(other._columns), _checked(other._checked) {}
 
 RPN& RPN::operator=(const RPN& other)
 {
 	if (this != &other)
+	{
 		_stack = other._stack;
+		_columns = other._columns;
+		_checked = other._checked;
+	}
 	return *this;
 }
 
 RPN::~RPN() {}
 
 // Helper functions
-bool RPN::isOperator(const std::string& token) const
-{
-	return (token == "+" || token == "-" || token == "*" || token == "/");
-}
 
-bool RPN::isNumber(const std::string& token) const
+// Next whitespace-separated token of [cursor, end), leaving cursor after
+// it. Numbers are an optional sign and at least one digit; the operators
+// are single characters.
+RPN::TokenKind RPN::nextToken(const char*& cursor, const char* end, long& value)
 {
-	if (token.empty())
-		return false;
-	
-	// Check for negative numbers
-	size_t start = 0;
-	if (token[0] == '-' || token[0] == '+')
-		start = 1;
-	
-	// Check if remaining characters are digits
-	for (size_t i = start; i < token.length(); ++i)
+	const char* p = cursor;
+	while (p < end && (classOf(*p) & SPACE))
+		++p;
+	if (p == end)
+	{
+		cursor = p;
+		return TOKEN_END;
+	}
+
+	const char* token = p;
+	unsigned char first = classOf(*p++);
+	bool digits = (first & DIGIT) != 0;
+	bool number = (first & (DIGIT | SIGN)) != 0;
+	while (p < end && !(classOf(*p) & SPACE))
+	{
+		bool digit = (classOf(*p++) & DIGIT) != 0;
+		number &= digit;
+		digits |= digit;
+	}
+	cursor = p;
+
+	if (p - token == 1 && (first & OPERATOR))
 	{
-		if (!isdigit(token[i]))
-			return false;
+		switch (*token)
+		{
+			case '+': value = RPNProgram::ADD; break;
+			case '-': value = RPNProgram::SUB; break;
+			case '*': value = RPNProgram::MUL; break;
+			default: value = RPNProgram::DIV; break;
+		}
+		return TOKEN_OPERATOR;
 	}
-	
-	return token.length() > start; 
-	// Make sure there's at least one digit
+	if (number && digits)
+	{
+		value = parseNumber(token, p);
+		return TOKEN_NUMBER;
+	}
+	return TOKEN_INVALID;
 }
 
-void RPN::performOperation(const std::string& op)
+// The long strtol() gives for a well-formed number, saturating out of
+// range; narrowed to int, this is what atoi() returns
+long RPN::parseNumber(const char* token, const char* end)
 {
-	if (_stack.size() < 2)
-		throw std::runtime_error("Error: insufficient operands");
-	
-	// Pop two operands (note the order!) remember stack oder you dolt!
-	int b = _stack.top();
-	_stack.pop();
-	int a = _stack.top();
-	_stack.pop();
-	
-	int result;
-	
-	if (op == "+")
-		result = a + b;
-	else if (op == "-")
-		result = a - b;
-	else if (op == "*")
-		result = a * b;
-	else if (op == "/")
+	bool negative = *token == '-';
+	if (*token == '-' || *token == '+')
+		++token;
+
+	// Saturate just past what a long can hold in either direction
+	const unsigned long limit = static_cast<unsigned long>(LONG_MAX) + 1;
+	unsigned long magnitude = 0;
+	for (; token < end; ++token)
 	{
-		if (b == 0)
-			throw std::runtime_error("Error: division by zero");
-		result = a / b;
+		unsigned long d = *token - '0';
+		magnitude = (magnitude > (limit - d) / 10) ? limit : magnitude * 10 + d;
 	}
+
+	long value;
+	if (negative)
+		value = magnitude >= limit ? LONG_MIN : -static_cast<long>(magnitude);
 	else
-		throw std::runtime_error("Error: unknown operator");
-	
-	_stack.push(result);
+		value = magnitude >= limit ? LONG_MAX : static_cast<long>(magnitude);
+	return value;
+}
+
+// Arithmetic that overflows an int throws instead of wrapping, and
+// numbers that do not fit in one are rejected
+void RPN::setChecked(bool checked)
+{
+	_checked = checked;
+}
+
+// Room for depth values at the bottom of the stack
+int* RPN::reserve(size_t depth)
+{
+	if (_stack.size() < depth)
+		_stack.resize(depth);
+	return &_stack[0];
 }
 
 int RPN::evaluate(const std::string& expression)
 {
-	std::istringstream iss(expression);
-	std::string token;
-	
-	// Clear the stack
-	while (!_stack.empty())
-		_stack.pop();
-	
-	while (iss >> token)
+	return evaluate(expression.data(), expression.size());
+}
+
+// One pass over the characters, straight onto the stack: no token copies
+// and no allocation once the stack has grown to fit
+int RPN::evaluate(const char* expression, size_t length)
+{
+	const char* cursor = expression;
+	const char* end = cursor + length;
+
+	// A number and its separator take at least two characters, which bounds
+	// the depth before the first token is read
+	int* base = reserve(length / 2 + 1);
+	int* top = base;
+	long value;
+
+	while (true)
 	{
-		if (isNumber(token))
+		TokenKind kind = nextToken(cursor, end, value);
+		if (kind == TOKEN_END)
+			break;
+		if (kind == TOKEN_NUMBER)
 		{
-			int num = atoi(token.c_str());
-			_stack.push(num);
+			if (_checked && (value < INT_MIN || value > INT_MAX))
+				throw std::runtime_error("Error: integer overflow");
+			*top++ = static_cast<int>(value);
 		}
-		else if (isOperator(token))
+		else if (kind == TOKEN_OPERATOR)
 		{
-			performOperation(token);
+			if (top - base < 2)
+				throw std::runtime_error("Error: insufficient operands");
+			// Pop two operands (note the order!) remember stack oder you dolt!
+			top[-2] = RPNProgram::apply(static_cast<int>(value), top[-2], top[-1], _checked);
+			--top;
 		}
 		else
-		{
 			throw std::runtime_error("Error: invalid token");
-		}
 	}
-	
+
 	// After processing all tokens, stack should have exactly one value
-	if (_stack.size() != 1)
+	if (top - base != 1)
 		throw std::runtime_error("Error: invalid expression");
-	
-	return _stack.top();
+
+	return base[0];
+}
+
+// Same tokens and errors as evaluate(), recorded into program instead of
+// being computed
+void RPN::compile(const std::string& expression, RPNProgram& program) const
+{
+	const char* cursor = expression.data();
+	const char* end = cursor + expression.size();
+	long value;
+
+	program.clear();
+	program.setChecked(_checked);
+	while (program.valid())
+	{
+		TokenKind kind = nextToken(cursor, end, value);
+		if (kind == TOKEN_END)
+			break;
+		if (kind == TOKEN_NUMBER)
+			program.pushNumber(value);
+		else if (kind == TOKEN_OPERATOR)
+			program.pushOperator(static_cast<RPNProgram::Opcode>(value));
+		else
+			program.fail("Error: invalid token");
+	}
+	program.finish();
+}
+
+// The stack is sized once per program depth and reused across runs
+int RPN::evaluate(const RPNProgram& program)
+{
+	return program.run(reserve(program.maxDepth()));
+}
+
+// Runs program over rows at once; columns[slot] supplies that operand for
+// every row, or is NULL to keep the compiled number. errors, if not NULL,
+// receives each row's error message (NULL for a result) instead of the
+// first one being thrown.
+void RPN::evaluateColumns(const RPNProgram& program, const int* const* columns, size_t rows, int* out,
+	const char** errors)
+{
+	program.runColumns(columns, rows, out, errors, _columns);
 }
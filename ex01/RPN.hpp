@@ -2,16 +2,30 @@
 #define RPN_HPP
 
 #include <string>
-#include <stack>
+#include <vector>
+#include "RPNProgram.hpp"
 
 class RPN
 {
 private:
-	std::stack<int> _stack;
-	
-	bool isOperator(const std::string& token) const;
-	bool isNumber(const std::string& token) const;
-	void performOperation(const std::string& op);
+	// Contiguous operand stack, grown only when an expression could need
+	// more room than any before it
+	std::vector<int> _stack;
+	std::vector<int> _columns;	// stack levels for RPNProgram::runColumns
+	bool _checked;
+
+	// What the tokenizer found; an operator's value is its RPNProgram opcode
+	enum TokenKind
+	{
+		TOKEN_END,
+		TOKEN_NUMBER,
+		TOKEN_OPERATOR,
+		TOKEN_INVALID
+	};
+
+	static TokenKind nextToken(const char*& cursor, const char* end, long& value);
+	static long parseNumber(const char* token, const char* end);
+	int* reserve(size_t depth);
 
 public:
 	// Orthodox Canonical Form
@@ -21,7 +35,15 @@ public:
 	~RPN();
 
 	// Methods
+	void setChecked(bool checked);
 	int evaluate(const std::string& expression);
+	int evaluate(const char* expression, size_t length);
+
+	// Parse once, then run as often as needed
+	void compile(const std::string& expression, RPNProgram& program) const;
+	int evaluate(const RPNProgram& program);
+	void evaluateColumns(const RPNProgram& program, const int* const* columns, size_t rows, int* out,
+		const char** errors);
 };
 
 #endif
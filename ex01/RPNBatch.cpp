@@ -0,0 +1,352 @@
+#include "RPNBatch.hpp"
+#include <iostream>
+#include <cstring>
+#include <climits>
+#include <cerrno>
+#include <exception>
+#include <unistd.h>
+#include <pthread.h>
+
+namespace
+{
+	void appendInt(std::string& output, int value)
+	{
+		char text[16];
+		char* end = text + sizeof(text);
+		char* p = end;
+		unsigned int magnitude = value < 0 ? 0u - static_cast<unsigned int>(value) : value;
+
+		do
+		{
+			*--p = static_cast<char>('0' + magnitude % 10);
+			magnitude /= 10;
+		}
+		while (magnitude > 0);
+		if (value < 0)
+			*--p = '-';
+		output.append(p, end - p);
+	}
+
+	bool writeAll(int fd, const std::string& output)
+	{
+		const char* data = output.data();
+		size_t size = output.size();
+
+		while (size > 0)
+		{
+			ssize_t written = ::write(fd, data, size);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written <= 0)
+				return false;
+			data += written;
+			size -= written;
+		}
+		return true;
+	}
+}
+
+// Chunks of one block, claimed in order by the threads working on it
+struct RPNBatch::Work
+{
+	RPNBatch* batch;
+	size_t next;
+	size_t workers;
+	pthread_mutex_t mutex;
+};
+
+RPNBatch::RPNBatch() : _threads(1), _checked(false), _calculators(1), _programs(1) {}
+
+RPNBatch::~RPNBatch() {}
+
+// Helper functions
+
+// Every line of data[0, size) gets exactly one line of output. A run of
+// identical lines is compiled into program at its second line and
+// evaluated from there on without parsing.
+void RPNBatch::evaluateLines(RPN& calculator, RPNProgram& program, const char* data, size_t size,
+	std::string& output)
+{
+	const char* end = data + size;
+	const char* line = data;
+	const char* previous = NULL;
+	size_t previousLength = 0;
+	bool compiled = false;
+
+	while (line < end)
+	{
+		const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		size_t length = (newline ? newline : end) - line;
+		bool repeat = previous && length == previousLength && std::memcmp(line, previous, length) == 0;
+
+		if (!repeat)
+		{
+			previous = line;
+			previousLength = length;
+			compiled = false;
+		}
+		try
+		{
+			if (repeat && !compiled)
+			{
+				calculator.compile(std::string(line, length), program);
+				compiled = true;
+			}
+			appendInt(output, repeat ? calculator.evaluate(program) : calculator.evaluate(line, length));
+		}
+		catch (const std::exception& e)
+		{
+			output += e.what();
+		}
+		output += '\n';
+		line = newline ? newline + 1 : end;
+	}
+}
+
+// One whitespace-separated integer of a column row, within int range
+bool RPNBatch::parseField(const char*& cursor, const char* end, int& value)
+{
+	const char* p = cursor;
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		++p;
+
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+'))
+		++p;
+	const char* digits = p;
+	long long magnitude = 0;
+	while (p < end && *p >= '0' && *p <= '9' && magnitude <= static_cast<long long>(INT_MAX) + 1)
+		magnitude = magnitude * 10 + (*p++ - '0');
+	if (p == digits || (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+		|| magnitude > static_cast<long long>(INT_MAX) + negative)
+		return false;
+
+	value = static_cast<int>(negative ? -magnitude : magnitude);
+	cursor = p;
+	return true;
+}
+
+void* RPNBatch::workerMain(void* arg)
+{
+	Work& work = *static_cast<Work*>(arg);
+
+	pthread_mutex_lock(&work.mutex);
+	size_t worker = work.workers++;
+	RPN& calculator = work.batch->_calculators[worker];
+	RPNProgram& program = work.batch->_programs[worker];
+	while (work.next < work.batch->_chunks.size())
+	{
+		Chunk& chunk = work.batch->_chunks[work.next++];
+		pthread_mutex_unlock(&work.mutex);
+
+		chunk.output.clear();
+		evaluateLines(calculator, program, chunk.data, chunk.size, chunk.output);
+
+		pthread_mutex_lock(&work.mutex);
+	}
+	pthread_mutex_unlock(&work.mutex);
+	return NULL;
+}
+
+// Whole lines in data[0, size), answered into output in input order
+void RPNBatch::processBlock(const char* data, size_t size, std::string& output)
+{
+	if (_threads <= 1 || size < PARALLEL_MIN)
+	{
+		evaluateLines(_calculators[0], _programs[0], data, size, output);
+		return;
+	}
+
+	// A few chunks per thread, so one slow chunk does not hold up the rest
+	const char* end = data + size;
+	size_t target = size / (4 * _threads) + 1;
+	size_t count = 0;
+	for (const char* p = data; p < end; ++count)
+	{
+		const char* cut = static_cast<size_t>(end - p) > target ? p + target : end;
+		const char* newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+
+		cut = newline ? newline + 1 : end;
+		if (count == _chunks.size())
+			_chunks.push_back(Chunk());
+		_chunks[count].data = p;
+		_chunks[count].size = cut - p;
+		p = cut;
+	}
+	_chunks.resize(count);
+
+	Work work;
+	work.batch = this;
+	work.next = 0;
+	work.workers = 0;
+	pthread_mutex_init(&work.mutex, NULL);
+
+	std::vector<pthread_t> threads;
+	for (size_t i = 1; i < _threads; ++i)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, &RPNBatch::workerMain, &work) == 0)
+			threads.push_back(thread);
+	}
+	workerMain(&work);
+	for (size_t i = 0; i < threads.size(); ++i)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&work.mutex);
+
+	for (size_t i = 0; i < _chunks.size(); ++i)
+		output += _chunks[i].output;
+}
+
+// Methods
+
+// Threads for large blocks, counting the caller (1 keeps it on the caller)
+void RPNBatch::setThreads(size_t threads)
+{
+	_threads = threads ? threads : 1;
+	_calculators.resize(_threads);
+	_programs.resize(_threads);
+	setChecked(_checked);
+}
+
+// Overflow-checked evaluation on every thread
+void RPNBatch::setChecked(bool checked)
+{
+	_checked = checked;
+	for (size_t i = 0; i < _calculators.size(); ++i)
+		_calculators[i].setChecked(checked);
+}
+
+// Read expressions from fd until EOF. Returns false on a read or write error.
+bool RPNBatch::run(int fd)
+{
+	std::vector<char> buffer(BLOCK_SIZE);
+	std::string output;
+	size_t have = 0;
+
+	while (true)
+	{
+		ssize_t got = ::read(fd, &buffer[have], buffer.size() - have);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got < 0)
+			return false;
+
+		size_t whole;
+		if (got == 0)
+		{
+			// A last line without a newline still counts
+			if (have == 0)
+				return true;
+			whole = have;
+		}
+		else
+		{
+			size_t before = have;
+			have += got;
+
+			// Only the new bytes can hold the last newline
+			whole = have;
+			while (whole > before && buffer[whole - 1] != '\n')
+				--whole;
+			if (whole == before)
+			{
+				// A line longer than the buffer: make room and read on
+				if (have == buffer.size())
+					buffer.resize(buffer.size() * 2);
+				continue;
+			}
+		}
+
+		output.clear();
+		processBlock(&buffer[0], whole, output);
+		if (!writeAll(1, output))
+			return false;
+		if (got == 0)
+			return true;
+		std::memmove(&buffer[0], &buffer[whole], have - whole);
+		have -= whole;
+	}
+}
+
+// Rows of integers from fd until EOF, all with the same number of columns,
+// at most the expression has numbers. One output line per row, the result
+// or the error message, as --batch gives for the expression with the
+// row's values written in. Returns false on a malformed row or an I/O error.
+bool RPNBatch::runColumns(const std::string& expression, int fd)
+{
+	std::vector<char> input;
+	char block[1 << 16];
+	while (true)
+	{
+		ssize_t got = ::read(fd, block, sizeof(block));
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got < 0)
+			return false;
+		if (got == 0)
+			break;
+		input.insert(input.end(), block, block + got);
+	}
+
+	// The expression is one argument, so like a single expression it fails
+	// as a whole
+	RPN& calculator = _calculators[0];
+	RPNProgram& program = _programs[0];
+	calculator.compile(expression, program);
+	if (!program.valid())
+	{
+		std::cerr << program.error() << std::endl;
+		return false;
+	}
+
+	// Column-major, as evaluateColumns takes them
+	std::vector<std::vector<int> > columns;
+	const char* end = input.empty() ? NULL : &input[0] + input.size();
+	size_t rows = 0;
+	for (const char* line = input.empty() ? NULL : &input[0]; line < end; ++rows)
+	{
+		const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		const char* stop = newline ? newline : end;
+		size_t field = 0;
+		bool ok = true;
+		int value;
+
+		for (const char* cursor = line; ok && cursor < stop; ++field)
+		{
+			ok = parseField(cursor, stop, value) && field < program.operandCount()
+				&& (rows == 0 || field < columns.size());
+			if (!ok)
+				break;
+			if (rows == 0)
+				columns.push_back(std::vector<int>());
+			columns[field].push_back(value);
+			while (cursor < stop && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+				++cursor;
+		}
+		if (!ok || field == 0 || field != columns.size())
+		{
+			std::cerr << "Error: bad row " << rows + 1 << std::endl;
+			return false;
+		}
+		line = newline ? newline + 1 : end;
+	}
+
+	std::vector<const int*> slots(program.operandCount(), static_cast<const int*>(NULL));
+	for (size_t k = 0; k < columns.size(); ++k)
+		slots[k] = &columns[k][0];
+	std::vector<int> results(rows);
+	std::vector<const char*> errors(rows);
+	if (rows > 0)
+		calculator.evaluateColumns(program, &slots[0], rows, &results[0], &errors[0]);
+
+	std::string output;
+	for (size_t r = 0; r < rows; ++r)
+	{
+		if (errors[r])
+			output += errors[r];
+		else
+			appendInt(output, results[r]);
+		output += '\n';
+	}
+	return writeAll(1, output);
+}
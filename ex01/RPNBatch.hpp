@@ -0,0 +1,62 @@
+#ifndef RPNBATCH_HPP
+#define RPNBATCH_HPP
+
+#include "RPN.hpp"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Evaluates one expression per input line and writes one output line per
+// input line, the result or the error message, so the two stay aligned.
+// Input is read in blocks and answered as whole lines arrive; output is
+// collected and written once per block.
+// A line that repeats the one before it is compiled once and rerun as an
+// RPNProgram, so a formula listed over and over is not parsed each time.
+// With more than one thread, large blocks are cut into line-aligned
+// chunks evaluated in parallel, each on its own RPN, and written in order.
+// runColumns() instead reads rows of integers and evaluates one expression
+// per row, column k standing in for the expression's k-th number, through
+// the columnar RPN::evaluateColumns.
+class RPNBatch
+{
+private:
+	// Below this many bytes a block is not worth splitting
+	static const size_t PARALLEL_MIN = 1 << 16;
+	static const size_t BLOCK_SIZE = 1 << 22;
+
+	struct Chunk
+	{
+		const char* data;
+		size_t size;
+		std::string output;
+	};
+	struct Work;
+
+	size_t _threads;
+	bool _checked;
+	std::vector<RPN> _calculators;
+	std::vector<RPNProgram> _programs;	// one per calculator, for repeated lines
+	std::vector<Chunk> _chunks;
+
+	// Holds per-thread state, not copyable
+	RPNBatch(const RPNBatch& other);
+	RPNBatch& operator=(const RPNBatch& other);
+
+	static void evaluateLines(RPN& calculator, RPNProgram& program, const char* data, size_t size,
+		std::string& output);
+	static void* workerMain(void* arg);
+	static bool parseField(const char*& cursor, const char* end, int& value);
+	void processBlock(const char* data, size_t size, std::string& output);
+
+public:
+	RPNBatch();
+	~RPNBatch();
+
+	// Methods
+	void setThreads(size_t threads);
+	void setChecked(bool checked);
+	bool run(int fd);
+	bool runColumns(const std::string& expression, int fd);
+};
+
+#endif
@@ -0,0 +1,328 @@
+#include "RPNProgram.hpp"
+#include "ColumnOps.hpp"
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+// Orthodox Canonical Form
+RPNProgram::RPNProgram() : _depth(0), _maxDepth(0), _error(NULL), _checked(false) {}
+
+RPNProgram::RPNProgram(const RPNProgram& other)
+	: _code(other._code), _operands(other._operands), _depth(other._depth),
+	  _maxDepth(other._maxDepth), _error(other._error), _checked(other._checked) {}
+
+RPNProgram& RPNProgram::operator=(const RPNProgram& other)
+{
+	if (this != &other)
+	{
+		_code = other._code;
+		_operands = other._operands;
+		_depth = other._depth;
+		_maxDepth = other._maxDepth;
+		_error = other._error;
+		_checked = other._checked;
+	}
+	return *this;
+}
+
+RPNProgram::~RPNProgram() {}
+
+// Building
+
+// Start over, keeping the buffers and the checked setting
+void RPNProgram::clear()
+{
+	_code.clear();
+	_operands.clear();
+	_depth = 0;
+	_maxDepth = 0;
+	_error = NULL;
+}
+
+// Set before the first token: checked numbers must also fit in an int
+void RPNProgram::setChecked(bool checked)
+{
+	_checked = checked;
+}
+
+// value as the tokenizer read it; unchecked, it is narrowed like atoi's
+void RPNProgram::pushNumber(long value)
+{
+	if (_error)
+		return;
+	if (_checked && (value < INT_MIN || value > INT_MAX))
+	{
+		fail("Error: integer overflow");
+		return;
+	}
+	_code.push_back(PUSH);
+	_operands.push_back(static_cast<int>(value));
+	if (++_depth > _maxDepth)
+		_maxDepth = _depth;
+}
+
+void RPNProgram::pushOperator(Opcode op)
+{
+	if (_error)
+		return;
+	if (_depth < 2)
+	{
+		fail("Error: insufficient operands");
+		return;
+	}
+	_code.push_back(static_cast<unsigned char>(op));
+	--_depth;
+}
+
+// The first error sticks; later tokens are ignored
+void RPNProgram::fail(const char* error)
+{
+	if (!_error)
+		_error = error;
+}
+
+// After the last token, exactly one value must be left
+void RPNProgram::finish()
+{
+	if (!_error && _depth != 1)
+		fail("Error: invalid expression");
+}
+
+// Methods
+
+bool RPNProgram::valid() const
+{
+	return _error == NULL;
+}
+
+const char* RPNProgram::error() const
+{
+	return _error;
+}
+
+bool RPNProgram::checked() const
+{
+	return _checked;
+}
+
+// Stack slots run() needs
+size_t RPNProgram::maxDepth() const
+{
+	return _maxDepth;
+}
+
+size_t RPNProgram::operandCount() const
+{
+	return _operands.size();
+}
+
+int RPNProgram::operand(size_t slot) const
+{
+	return _operands[slot];
+}
+
+void RPNProgram::setOperand(size_t slot, int value)
+{
+	_operands[slot] = value;
+}
+
+// stack must hold maxDepth() values. Division by zero and INT_MIN / -1
+// are the only checks left at run time; a program that failed to compile throws its error
+// once the opcodes before it have run.
+int RPNProgram::run(int* stack) const
+{
+	const int* operand = _operands.empty() ? NULL : &_operands[0];
+	int* top = stack;
+
+	for (size_t i = 0; i < _code.size(); ++i)
+	{
+		if (_checked && _code[i] != PUSH)
+		{
+			top[-2] = apply(_code[i], top[-2], top[-1], true);
+			--top;
+			continue;
+		}
+		switch (_code[i])
+		{
+			case PUSH:
+				*top++ = *operand++;
+				break;
+			case ADD:
+				top[-2] = top[-2] + top[-1];
+				--top;
+				break;
+			case SUB:
+				top[-2] = top[-2] - top[-1];
+				--top;
+				break;
+			case MUL:
+				top[-2] = top[-2] * top[-1];
+				--top;
+				break;
+			case DIV:
+				if (top[-1] == 0)
+					throw std::runtime_error("Error: division by zero");
+				if (top[-1] == -1 && top[-2] == INT_MIN)
+					throw std::runtime_error("Error: integer overflow");
+				top[-2] = top[-2] / top[-1];
+				--top;
+				break;
+		}
+	}
+	if (_error)
+		throw std::runtime_error(_error);
+	return top[-1];
+}
+
+// INT_MIN / -1 traps like division by zero does, so it is an error even
+// unchecked
+int RPNProgram::apply(int op, int a, int b, bool checked)
+{
+	int result;
+	const char* error = compute(op, a, b, checked, result);
+	if (error)
+		throw std::runtime_error(error);
+	return result;
+}
+
+// apply() without the throw: the error message, or NULL with result set
+const char* RPNProgram::compute(int op, int a, int b, bool checked, int& result)
+{
+	if (op == DIV && b == 0)
+		return "Error: division by zero";
+	if (op == DIV && b == -1 && a == INT_MIN)
+		return "Error: integer overflow";
+	if (!checked)
+	{
+		switch (op)
+		{
+			case ADD:
+				result = a + b;
+				break;
+			case SUB:
+				result = a - b;
+				break;
+			case MUL:
+				result = a * b;
+				break;
+			default:
+				result = a / b;
+				break;
+		}
+		return NULL;
+	}
+
+	// Exact in 64 bits, then range-checked
+	long long wide;
+	switch (op)
+	{
+		case ADD:
+			wide = static_cast<long long>(a) + b;
+			break;
+		case SUB:
+			wide = static_cast<long long>(a) - b;
+			break;
+		case MUL:
+			wide = static_cast<long long>(a) * b;
+			break;
+		default:
+			wide = static_cast<long long>(a) / b;
+			break;
+	}
+	if (wide < INT_MIN || wide > INT_MAX)
+		return "Error: integer overflow";
+	result = static_cast<int>(wide);
+	return NULL;
+}
+
+void RPNProgram::throwAtRow(const char* error, size_t row)
+{
+	std::ostringstream message;
+	message << error << " in row " << row;
+	throw std::runtime_error(message.str());
+}
+
+// out[r] = the program's result with each slot s bound to columns[s][r],
+// or to its compiled value where columns[s] is NULL, for r in [0, rows).
+// Rows are taken COLUMN_BLOCK at a time: every stack level is a column of
+// the block and each opcode is one element-wise pass, vectorised by
+// ColumnOps; a checked program runs its arithmetic row by row.
+// A row that fails keeps the first error it met, as evaluate() would give
+// for it, and its out[r] is left undefined. With errors, errors[r] is that
+// message or NULL and every row is answered; without, the first failing
+// row throws, naming the row.
+void RPNProgram::runColumns(const int* const* columns, size_t rows, int* out, const char** errors,
+	std::vector<int>& workspace) const
+{
+	if (workspace.size() < _maxDepth * COLUMN_BLOCK)
+		workspace.resize(_maxDepth * COLUMN_BLOCK);
+
+	const char* blockErrors[COLUMN_BLOCK];
+	for (size_t first = 0; first < rows; first += COLUMN_BLOCK)
+	{
+		size_t n = (rows - first > COLUMN_BLOCK) ? COLUMN_BLOCK : rows - first;
+		const char** failed = errors ? errors + first : blockErrors;
+		int* level = &workspace[0];
+		size_t slot = 0;
+
+		for (size_t r = 0; r < n; ++r)
+			failed[r] = NULL;
+		for (size_t i = 0; i < _code.size(); ++i)
+		{
+			unsigned char op = _code[i];
+			if (op == PUSH)
+			{
+				const int* column = columns[slot];
+				if (column)
+					std::memcpy(level, column + first, n * sizeof(int));
+				else
+					for (size_t r = 0; r < n; ++r)
+						level[r] = _operands[slot];
+				++slot;
+				level += COLUMN_BLOCK;
+				continue;
+			}
+
+			int* a = level - 2 * COLUMN_BLOCK;
+			const int* b = level - COLUMN_BLOCK;
+			if (_checked)
+			{
+				for (size_t r = 0; r < n; ++r)
+				{
+					const char* error = compute(op, a[r], b[r], true, a[r]);
+					if (error && !failed[r])
+						failed[r] = error;
+				}
+			}
+			else if (op == ADD)
+				ColumnOps::add(a, b, n);
+			else if (op == SUB)
+				ColumnOps::sub(a, b, n);
+			else if (op == MUL)
+				ColumnOps::mul(a, b, n);
+			else
+			{
+				// div stops at each row it cannot divide; carry on past it
+				size_t r = ColumnOps::div(a, b, n);
+				while (r < n)
+				{
+					if (!failed[r])
+						failed[r] = (b[r] == 0) ? "Error: division by zero" : "Error: integer overflow";
+					++r;
+					r += ColumnOps::div(a + r, b + r, n - r);
+				}
+			}
+			level -= COLUMN_BLOCK;
+		}
+
+		for (size_t r = 0; r < n; ++r)
+		{
+			if (_error && !failed[r])
+				failed[r] = _error;
+			if (failed[r] && !errors)
+				throwAtRow(failed[r], first + r);
+		}
+		std::memcpy(out + first, &workspace[0], n * sizeof(int));
+	}
+}
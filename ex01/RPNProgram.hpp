@@ -0,0 +1,78 @@
+#ifndef RPNPROGRAM_HPP
+#define RPNPROGRAM_HPP
+
+#include <vector>
+#include <cstddef>
+
+// An RPN expression compiled to one opcode per token, checked once for
+// stack depth so that running it needs no bounds checks.
+// Number tokens become operand slots, numbered in order of appearance;
+// setOperand() rebinds a slot, so the same program can be rerun on new
+// inputs without parsing again.
+// An expression that fails to compile keeps the opcodes before the first
+// bad token together with its error, and run() reports that error after
+// running them, so errors come out in the same order as a token-by-token
+// evaluation would give.
+// A checked program reports int overflow as an error instead of wrapping
+// into undefined behaviour. runColumns() evaluates the program once per row
+// with operand slots bound to arrays, one opcode at a time over a block of
+// rows, and can report errors row by row.
+class RPNProgram
+{
+public:
+	enum Opcode
+	{
+		PUSH,
+		ADD,
+		SUB,
+		MUL,
+		DIV
+	};
+
+private:
+	std::vector<unsigned char> _code;
+	std::vector<int> _operands;
+	size_t _depth;
+	size_t _maxDepth;
+	const char* _error;
+	bool _checked;
+
+	// Rows per block in runColumns()
+	static const size_t COLUMN_BLOCK = 256;
+
+	static void throwAtRow(const char* error, size_t row);
+
+public:
+	// Orthodox Canonical Form
+	RPNProgram();
+	RPNProgram(const RPNProgram& other);
+	RPNProgram& operator=(const RPNProgram& other);
+	~RPNProgram();
+
+	// Building, one token at a time
+	void clear();
+	void setChecked(bool checked);
+	void pushNumber(long value);
+	void pushOperator(Opcode op);
+	void fail(const char* error);
+	void finish();
+
+	// Methods
+	bool valid() const;
+	const char* error() const;
+	size_t maxDepth() const;
+	size_t operandCount() const;
+	int operand(size_t slot) const;
+	void setOperand(size_t slot, int value);
+	bool checked() const;
+	int run(int* stack) const;
+	void runColumns(const int* const* columns, size_t rows, int* out, const char** errors,
+		std::vector<int>& workspace) const;
+
+	// a op b for a binary opcode; checked throws on int overflow, and
+	// INT_MIN / -1 throws either way
+	static int apply(int op, int a, int b, bool checked);
+	static const char* compute(int op, int a, int b, bool checked, int& result);
+};
+
+#endif
@@ -1,20 +1,132 @@
 #include "RPN.hpp"
+#include "RPNBatch.hpp"
 #include <iostream>
+#include <string>
 #include <exception>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Option argument: a positive decimal count
+static bool parseCount(const char* str, size_t& out)
+{
+	char* end;
+	unsigned long value = std::strtoul(str, &end, 10);
+
+	if (*str < '0' || *str > '9' || *end != '\0' || value == 0)
+		return false;
+	out = value;
+	return true;
+}
+
+// Only these are options; anything else, "--1 2 +" included, is left to
+// the evaluator as an expression
+static bool isOption(const std::string& arg)
+{
+	return arg == "--batch" || arg == "--checked" || arg == "--threads" || arg == "--columns";
+}
+
+// One expression per line of path, or of stdin when path is NULL, one
+// result or error per line on stdout
+static int runBatch(RPNBatch& batch, const char* path)
+{
+	int fd = 0;
+	if (path)
+	{
+		fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+		{
+			std::cerr << "Error: could not open file." << std::endl;
+			return 1;
+		}
+	}
+	bool ok = batch.run(fd);
+	if (fd != 0)
+		::close(fd);
+	return ok ? 0 : 1;
+}
 
 int main(int argc, char** argv)
 {
-	if (argc != 2)
+	RPNBatch batch;
+	bool checked = false;
+	bool batchMode = false;
+	const char* columnsPath = NULL;
+	int first = 1;
+	size_t count;
+
+	// Leading options; the expression, or the batch file, follows
+	while (first < argc && isOption(argv[first]))
+	{
+		std::string opt(argv[first]);
+
+		if (opt == "--batch")
+			batchMode = true;
+		else if (opt == "--checked")
+			checked = true;
+		else if (opt == "--columns")
+		{
+			if (first + 1 >= argc)
+			{
+				std::cerr << "Error: --columns needs a file" << std::endl;
+				return 1;
+			}
+			columnsPath = argv[first + 1];
+			++first;
+		}
+		else
+		{
+			if (first + 1 >= argc || !parseCount(argv[first + 1], count))
+			{
+				std::cerr << "Error: --threads needs a positive count" << std::endl;
+				return 1;
+			}
+			batch.setThreads(count);
+			++first;
+		}
+		++first;
+	}
+
+	// One expression over every row of a column file
+	if (columnsPath && !batchMode && argc - first == 1)
+	{
+		int fd = ::open(columnsPath, O_RDONLY);
+		if (fd < 0)
+		{
+			std::cerr << "Error: could not open file." << std::endl;
+			return 1;
+		}
+		batch.setChecked(checked);
+		bool ok = batch.runColumns(argv[first], fd);
+		::close(fd);
+		return ok ? 0 : 1;
+	}
+
+	if (batchMode && !columnsPath)
+	{
+		if (argc - first > 1)
+		{
+			std::cerr << "Error: invalid number of arguments" << std::endl;
+			return 1;
+		}
+		batch.setChecked(checked);
+		return runBatch(batch, first < argc ? argv[first] : NULL);
+	}
+
+	if (argc - first != 1 || columnsPath)
 	{
 		std::cerr << "Error: invalid number of arguments" << std::endl;
-		std::cerr << "Usage: ./RPN \"expression\"" << std::endl;
+		std::cerr << "Usage: ./RPN [--checked] \"expression\"" << std::endl;
+		std::cerr << "       ./RPN --batch [--checked] [--threads N] [file]" << std::endl;
+		std::cerr << "       ./RPN --columns file [--checked] \"expression\"" << std::endl;
 		return 1;
 	}
 
 	try
 	{
 		RPN calculator;
-		int result = calculator.evaluate(argv[1]);
+		calculator.setChecked(checked);
+		int result = calculator.evaluate(argv[first]);
 		std::cout << result << std::endl;
 	}
 	catch (const std::exception& e)
@@ -0,0 +1,48 @@
+#ifndef BLOCKEDCHAIN_HPP
+#define BLOCKEDCHAIN_HPP
+
+#include <vector>
+#include <cstddef>
+
+// Sequence split into fixed-capacity blocks, stored back to back in one pool.
+// Element access by rank is O(log blocks) and insertion only shifts one block
+// plus the block index, so a chain of n elements costs O(sqrt(n)) per insert
+// instead of the O(n) tail shift of std::vector::insert.
+template <typename T>
+class BlockedChain
+{
+private:
+	std::vector<T> _pool;			// block storage, _capacity slots per block
+	std::vector<size_t> _blocks;	// pool slot of each block, in chain order
+	std::vector<size_t> _counts;	// elements used in each block
+	std::vector<size_t> _starts;	// rank of the first element of each block
+	size_t _capacity;
+	size_t _size;
+
+	size_t findBlock(size_t rank) const;
+	void splitBlock(size_t b);
+
+public:
+	// Orthodox Canonical Form
+	BlockedChain();
+	BlockedChain(const BlockedChain& other);
+	BlockedChain& operator=(const BlockedChain& other);
+	~BlockedChain();
+
+	// Methods
+	void reset(size_t expectedSize);
+	size_t size() const;
+	const T& operator[](size_t rank) const;
+	size_t insert(size_t rank, const T& value);
+	void push_back(const T& value);
+
+	template <typename Value, typename Less>
+	size_t lowerBound(size_t hi, const Value& value, const Less& less) const;
+
+	template <typename Container>
+	void copyTo(Container& out) const;
+};
+
+#include "BlockedChain.tpp"
+
+#endif
@@ -0,0 +1,179 @@
+#include <algorithm>
+
+// Orthodox Canonical Form
+template <typename T>
+BlockedChain<T>::BlockedChain() : _capacity(64), _size(0) {}
+
+template <typename T>
+BlockedChain<T>::BlockedChain(const BlockedChain& other)
+	: _pool(other._pool), _blocks(other._blocks), _counts(other._counts),
+	  _starts(other._starts), _capacity(other._capacity), _size(other._size) {}
+
+template <typename T>
+BlockedChain<T>& BlockedChain<T>::operator=(const BlockedChain& other)
+{
+	if (this != &other)
+	{
+		_pool = other._pool;
+		_blocks = other._blocks;
+		_counts = other._counts;
+		_starts = other._starts;
+		_capacity = other._capacity;
+		_size = other._size;
+	}
+	return *this;
+}
+
+template <typename T>
+BlockedChain<T>::~BlockedChain() {}
+
+// Empty the chain and pick a block capacity around sqrt(expectedSize)
+template <typename T>
+void BlockedChain<T>::reset(size_t expectedSize)
+{
+	_capacity = 64;
+	while (_capacity * _capacity < expectedSize)
+		_capacity *= 2;
+	
+	_pool.clear();
+	_blocks.clear();
+	_counts.clear();
+	_starts.clear();
+	_size = 0;
+	
+	// Blocks stay at least half full, so this is enough for expectedSize
+	// elements: a reused chain never reallocates for the same or smaller sizes
+	size_t maxBlocks = 2 * expectedSize / _capacity + 2;
+	_pool.reserve(maxBlocks * _capacity);
+	_blocks.reserve(maxBlocks);
+	_counts.reserve(maxBlocks);
+	_starts.reserve(maxBlocks);
+}
+
+template <typename T>
+size_t BlockedChain<T>::size() const
+{
+	return _size;
+}
+
+// Block holding rank; rank == size() maps to the last block
+template <typename T>
+size_t BlockedChain<T>::findBlock(size_t rank) const
+{
+	return std::upper_bound(_starts.begin(), _starts.end(), rank) - _starts.begin() - 1;
+}
+
+// Move the upper half of a full block into a fresh pool slot after it
+template <typename T>
+void BlockedChain<T>::splitBlock(size_t b)
+{
+	size_t slot = _pool.size() / _capacity;
+	_pool.resize(_pool.size() + _capacity);
+	
+	size_t half = _counts[b] / 2;
+	typename std::vector<T>::iterator from = _pool.begin() + _blocks[b] * _capacity;
+	std::copy(from + half, from + _counts[b], _pool.begin() + slot * _capacity);
+	
+	_blocks.insert(_blocks.begin() + b + 1, slot);
+	_counts.insert(_counts.begin() + b + 1, _counts[b] - half);
+	_starts.insert(_starts.begin() + b + 1, _starts[b] + half);
+	_counts[b] = half;
+}
+
+template <typename T>
+const T& BlockedChain<T>::operator[](size_t rank) const
+{
+	size_t b = findBlock(rank);
+	return _pool[_blocks[b] * _capacity + (rank - _starts[b])];
+}
+
+// Returns the number of elements written, shifts and splits included
+template <typename T>
+size_t BlockedChain<T>::insert(size_t rank, const T& value)
+{
+	size_t moves = 1;
+	
+	if (_blocks.empty())
+	{
+		_pool.resize(_capacity);
+		_blocks.push_back(0);
+		_counts.push_back(0);
+		_starts.push_back(0);
+	}
+	
+	size_t b = findBlock(rank);
+	if (_counts[b] == _capacity)
+	{
+		moves += _capacity - _capacity / 2;
+		splitBlock(b);
+		if (rank > _starts[b + 1])
+			++b;
+	}
+	
+	// Shift the tail of this block only
+	typename std::vector<T>::iterator first = _pool.begin() + _blocks[b] * _capacity;
+	typename std::vector<T>::iterator pos = first + (rank - _starts[b]);
+	std::copy_backward(pos, first + _counts[b], first + _counts[b] + 1);
+	*pos = value;
+	moves += (first + _counts[b]) - pos;
+	
+	++_counts[b];
+	for (size_t i = b + 1; i < _starts.size(); ++i)
+		++_starts[i];
+	++_size;
+	return moves;
+}
+
+template <typename T>
+void BlockedChain<T>::push_back(const T& value)
+{
+	insert(_size, value);
+}
+
+// First rank in [0, hi) whose element is not less than value. Probes are
+// the midpoints of a plain binary search by rank, so it makes the same
+// comparisons; but each probe's block is looked up only among the blocks
+// the remaining range spans, and once that is one block, directly.
+template <typename T>
+template <typename Value, typename Less>
+size_t BlockedChain<T>::lowerBound(size_t hi, const Value& value, const Less& less) const
+{
+	size_t lo = 0;
+	
+	if (hi == 0)
+		return 0;
+	size_t first = 0;
+	size_t last = findBlock(hi - 1);
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		size_t b = first;
+		if (first != last)
+			b = std::upper_bound(_starts.begin() + first, _starts.begin() + last + 1, mid) - _starts.begin() - 1;
+		
+		if (less(_pool[_blocks[b] * _capacity + (mid - _starts[b])], value))
+		{
+			lo = mid + 1;
+			first = b;
+		}
+		else
+		{
+			hi = mid;
+			last = b;
+		}
+	}
+	return lo;
+}
+
+template <typename T>
+template <typename Container>
+void BlockedChain<T>::copyTo(Container& out) const
+{
+	out.clear();
+	for (size_t b = 0; b < _blocks.size(); ++b)
+	{
+		const T* first = &_pool[_blocks[b] * _capacity];
+		for (size_t i = 0; i < _counts[b]; ++i)
+			out.push_back(first[i]);
+	}
+}
@@ -0,0 +1,82 @@
+#include "JacobsthalOrder.hpp"
+
+namespace
+{
+	// J(0) .. J(MAX - 1); J(MAX - 1) is past any size_t pend size
+	const size_t JACOBSTHAL_MAX = sizeof(size_t) * 8;
+
+	// Jacobsthal number: J(n) = J(n-1) + 2*J(n-2), J(0)=0, J(1)=1
+	// Sequence: 0, 1, 1, 3, 5, 11, 21, 43, 85, 171, 341, ...
+	struct JacobsthalTable
+	{
+		size_t values[JACOBSTHAL_MAX];
+
+		JacobsthalTable()
+		{
+			values[0] = 0;
+			values[1] = 1;
+			for (size_t i = 2; i < JACOBSTHAL_MAX; ++i)
+				values[i] = values[i - 1] + 2 * values[i - 2];
+		}
+	};
+
+	const JacobsthalTable g_table;
+}
+
+// Orthodox Canonical Form
+JacobsthalOrder::JacobsthalOrder() : _covered(0), _groups(0) {}
+
+JacobsthalOrder::JacobsthalOrder(const JacobsthalOrder& other)
+	: _order(other._order), _covered(other._covered), _groups(other._groups) {}
+
+JacobsthalOrder& JacobsthalOrder::operator=(const JacobsthalOrder& other)
+{
+	if (this != &other)
+	{
+		_order = other._order;
+		_covered = other._covered;
+		_groups = other._groups;
+	}
+	return *this;
+}
+
+JacobsthalOrder::~JacobsthalOrder() {}
+
+size_t JacobsthalOrder::jacobsthal(size_t n)
+{
+	return g_table.values[n];
+}
+
+// Append whole groups until pendSize indices are covered.
+// Indices are relative to pend[1..]: pend[0] is already in the main chain,
+// so group g covers index J(g + 3) - 2 down to J(g + 2) - 1, from highest
+// to lowest, and sits at those same offsets in the buffer.
+void JacobsthalOrder::reserve(size_t pendSize)
+{
+	while (_covered < pendSize)
+	{
+		size_t high = jacobsthal(_groups + 3) - 2;
+		
+		_order.reserve(high + 1);
+		for (size_t j = high + 1; j > _covered; --j)
+			_order.push_back(j - 1);
+		_covered = high + 1;
+		++_groups;
+	}
+}
+
+// Requires reserve(pendSize) beforehand
+JacobsthalOrder::View JacobsthalOrder::view(size_t pendSize) const
+{
+	if (pendSize == 0)
+		return View(NULL, 0, 0, 0);
+	
+	// Group holding the last index; its indices past the end come first
+	size_t g = 0;
+	while (jacobsthal(g + 3) - 2 < pendSize - 1)
+		++g;
+	size_t low = jacobsthal(g + 2) - 1;
+	size_t high = jacobsthal(g + 3) - 2;
+	
+	return View(&_order[0], pendSize, low, high - (pendSize - 1));
+}
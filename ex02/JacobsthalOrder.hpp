@@ -0,0 +1,53 @@
+#ifndef JACOBSTHALORDER_HPP
+#define JACOBSTHALORDER_HPP
+
+#include <vector>
+#include <cstddef>
+
+// Cached Ford-Johnson insertion order.
+// Jacobsthal numbers come from a table filled once at startup. Insertion
+// orders are stored once for whole groups and extended only when a larger
+// pend is requested; the order for any pend size is then a View over that
+// buffer, so every recursion level and every later sort reuses it without
+// recomputing or allocating.
+class JacobsthalOrder
+{
+public:
+	// Insertion order for one pend size: the cached groups, minus the indices
+	// of the last group that lie past the end of pend
+	class View
+	{
+	private:
+		const size_t* _order;
+		size_t _size;
+		size_t _split;
+		size_t _skip;
+
+	public:
+		View(const size_t* order, size_t size, size_t split, size_t skip)
+			: _order(order), _size(size), _split(split), _skip(skip) {}
+
+		size_t size() const { return _size; }
+		size_t operator[](size_t j) const { return _order[j < _split ? j : j + _skip]; }
+	};
+
+private:
+	std::vector<size_t> _order;	// complete groups, in insertion order
+	size_t _covered;			// pend size the complete groups cover
+	size_t _groups;
+
+public:
+	// Orthodox Canonical Form
+	JacobsthalOrder();
+	JacobsthalOrder(const JacobsthalOrder& other);
+	JacobsthalOrder& operator=(const JacobsthalOrder& other);
+	~JacobsthalOrder();
+
+	// Methods
+	void reserve(size_t pendSize);
+	View view(size_t pendSize) const;
+
+	static size_t jacobsthal(size_t n);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "LeafSort.hpp"
+#include <climits>
+
+#if !defined(PMERGEME_NO_SIMD) && defined(__AVX2__)
+# define LEAF_AVX2
+# include <immintrin.h>
+#elif !defined(PMERGEME_NO_SIMD) && defined(__SSE2__)
+# define LEAF_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Lane numbers, to mask out the keys at or after position i
+	const int g_lanes[LeafSort::MAX_SIZE] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+}
+
+#if defined(LEAF_AVX2)
+
+void LeafSort::rankOrder(const int* keys, size_t n, size_t* order)
+{
+	int padded[MAX_SIZE];
+	
+	// Padding is never below a real key, and lies after all of them
+	for (size_t i = 0; i < MAX_SIZE; ++i)
+		padded[i] = i < n ? keys[i] : INT_MAX;
+	
+	__m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(padded));
+	__m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(padded + 8));
+	__m256i lanesLo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(g_lanes));
+	__m256i lanesHi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(g_lanes + 8));
+	
+	for (size_t i = 0; i < n; ++i)
+	{
+		__m256i key = _mm256_set1_epi32(padded[i]);
+		__m256i pos = _mm256_set1_epi32(static_cast<int>(i));
+		
+		// keys[j] < key, or keys[j] == key with j < i
+		__m256i beforeLo = _mm256_or_si256(_mm256_cmpgt_epi32(key, lo),
+			_mm256_and_si256(_mm256_cmpeq_epi32(key, lo), _mm256_cmpgt_epi32(pos, lanesLo)));
+		__m256i beforeHi = _mm256_or_si256(_mm256_cmpgt_epi32(key, hi),
+			_mm256_and_si256(_mm256_cmpeq_epi32(key, hi), _mm256_cmpgt_epi32(pos, lanesHi)));
+		
+		int rank = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(beforeLo)))
+			+ __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(beforeHi)));
+		order[rank] = i;
+	}
+}
+
+const char* LeafSort::kind()
+{
+	return "avx2";
+}
+
+#elif defined(LEAF_SSE2)
+
+void LeafSort::rankOrder(const int* keys, size_t n, size_t* order)
+{
+	int padded[MAX_SIZE];
+	__m128i block[MAX_SIZE / 4];
+	__m128i lanes[MAX_SIZE / 4];
+	size_t blocks = (n + 3) / 4;
+	
+	// Padding is never below a real key, and lies after all of them
+	for (size_t i = 0; i < MAX_SIZE; ++i)
+		padded[i] = i < n ? keys[i] : INT_MAX;
+	for (size_t b = 0; b < blocks; ++b)
+	{
+		block[b] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(padded + 4 * b));
+		lanes[b] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g_lanes + 4 * b));
+	}
+	
+	for (size_t i = 0; i < n; ++i)
+	{
+		__m128i key = _mm_set1_epi32(padded[i]);
+		__m128i pos = _mm_set1_epi32(static_cast<int>(i));
+		int rank = 0;
+		
+		// keys[j] < key, or keys[j] == key with j < i
+		for (size_t b = 0; b < blocks; ++b)
+		{
+			__m128i before = _mm_or_si128(_mm_cmpgt_epi32(key, block[b]),
+				_mm_and_si128(_mm_cmpeq_epi32(key, block[b]), _mm_cmpgt_epi32(pos, lanes[b])));
+			rank += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(before)));
+		}
+		order[rank] = i;
+	}
+}
+
+const char* LeafSort::kind()
+{
+	return "sse2";
+}
+
+#else
+
+void LeafSort::rankOrder(const int* keys, size_t n, size_t* order)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		size_t rank = 0;
+		
+		for (size_t j = 0; j < n; ++j)
+			rank += (keys[j] < keys[i]) | ((keys[j] == keys[i]) & (j < i));
+		order[rank] = i;
+	}
+}
+
+const char* LeafSort::kind()
+{
+	return "scalar";
+}
+
+#endif
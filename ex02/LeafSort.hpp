@@ -0,0 +1,22 @@
+#ifndef LEAFSORT_HPP
+#define LEAFSORT_HPP
+
+#include <cstddef>
+
+// Base case for small levels of the merge-insert recursion.
+// Every key is compared against every other one at once and its rank is the
+// number of keys before it in sorted order (ties broken by position), so
+// the leaf has no data-dependent branches. Which instruction set does the
+// all-pairs compare is picked at build time with SIMD= in the Makefile.
+namespace LeafSort
+{
+	const size_t MAX_SIZE = 16;
+
+	// order[rank] = position, for keys[0, n) with n <= MAX_SIZE
+	void rankOrder(const int* keys, size_t n, size_t* order);
+
+	// "avx2", "sse2" or "scalar"
+	const char* kind();
+}
+
+#endif
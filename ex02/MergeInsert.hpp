@@ -0,0 +1,145 @@
+#ifndef MERGEINSERT_HPP
+#define MERGEINSERT_HPP
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <functional>
+
+#include "BlockedChain.hpp"
+#include "ScratchArena.hpp"
+#include "JacobsthalOrder.hpp"
+#include "SortStats.hpp"
+#include "ThreadPool.hpp"
+#include "LeafSort.hpp"
+
+// Ford-Johnson merge-insertion kernel, written once for any random-access
+// sequence and any strict weak ordering.
+//
+// Storage picks the container family used for the working sequences at every
+// level of the recursion (pairs, pend, main chain), so the std::vector and
+// std::deque sorts share one implementation but keep their own memory layout.
+// Seq<T>::keys() is how a level reads another level's keys: contiguous
+// storage hands out a plain pointer, so every level below the top compares
+// through const T* whatever the caller's iterator type.
+// Seq<T>::init() sizes a sequence and reserves room for capacity elements.
+// chunkedChain runs every insertion phase on a BlockedChain, as
+// config.blockedChain does: std::deque gets chunk-local inserts and
+// segment-aware searches there instead of shifting through its blocks and
+// probing its main chain by index.
+//
+// With config.pool set, levels of at least parallelThreshold keys pair up
+// and binary-search each Jacobsthal group on the pool's threads, so comp
+// must be safe to call concurrently. Group members that land on the same
+// rank are merge-sorted afterwards, on top of F(n). Those levels keep their main chain in
+// heap vectors whatever the Storage.
+//
+// config.leafSize trades comparisons for speed at the bottom of the
+// recursion: levels of up to leafSize keys (at most LeafSort::MAX_SIZE) rank
+// all keys against each other instead, vectorized for int under std::less.
+// The default of 0 keeps the comparison count within F(n).
+//
+// config.adaptive adds an O(n) pre-pass that splits the input into runs
+// which either never descend or strictly descend (about n comparisons).
+// A single run is left as is or reversed; input of at most n / 8 runs has
+// its runs turned ascending and merged pairwise in O(n log runs) instead.
+// Everything else goes through Ford-Johnson, the pre-pass on top of F(n).
+struct MergeInsertConfig;
+
+struct VectorStorage
+{
+	static const bool chunkedChain = false;
+
+	template <typename T>
+	struct Seq
+	{
+		typedef std::vector<T> type;
+		typedef const T* const_keys;
+
+		static const_keys keys(const type& seq) { return &seq[0]; }
+		static void init(type& seq, size_t size, size_t capacity, const MergeInsertConfig&)
+		{
+			seq.reserve(capacity);
+			seq.resize(size);
+		}
+	};
+};
+
+struct DequeStorage
+{
+	static const bool chunkedChain = true;
+
+	template <typename T>
+	struct Seq
+	{
+		typedef std::deque<T> type;
+		typedef typename std::deque<T>::const_iterator const_keys;
+
+		static const_keys keys(const type& seq) { return seq.begin(); }
+		static void init(type& seq, size_t size, size_t, const MergeInsertConfig&)
+		{
+			seq.resize(size);
+		}
+	};
+};
+
+// Every working array comes from config.arena (see ScratchArena)
+struct ArenaStorage
+{
+	static const bool chunkedChain = false;
+
+	template <typename T>
+	struct Seq
+	{
+		typedef ArenaSeq<T> type;
+		typedef const T* const_keys;
+
+		static const_keys keys(const type& seq) { return seq.data(); }
+		static void init(type& seq, size_t size, size_t capacity, const MergeInsertConfig& config);
+	};
+};
+
+// Per-sort settings threaded through every level
+struct MergeInsertConfig
+{
+	bool blockedChain;		// insertion phase on a BlockedChain
+	SortStats* stats;		// NULL disables instrumentation
+	ScratchArena* arena;	// required by ArenaStorage, also reuses its BlockedChain
+	JacobsthalOrder* jacobsthal;	// cached insertion orders; NULL uses one per sort
+	ThreadPool* pool;		// runs levels of at least parallelThreshold keys in parallel
+	size_t parallelThreshold;
+	size_t leafSize;		// levels this small are rank-sorted; 0 keeps Ford-Johnson throughout
+	bool adaptive;			// presortedness pre-pass with sorted, reversed and run-merge paths
+
+	MergeInsertConfig()
+		: blockedChain(false), stats(NULL), arena(NULL), jacobsthal(NULL), pool(NULL),
+		  parallelThreshold(4096), leafSize(0), adaptive(false) {}
+};
+
+// Generic random-access range
+template <typename Storage, typename RandomIt, typename Compare>
+void mergeInsertSort(RandomIt first, RandomIt last, Compare comp, const MergeInsertConfig& config);
+
+// Contiguous storage: keys are read through a plain pointer
+template <typename Storage, typename T, typename Compare>
+void mergeInsertSort(T* first, T* last, Compare comp, const MergeInsertConfig& config);
+
+template <typename Storage, typename T, typename Compare>
+void mergeInsertSort(std::vector<T>& data, Compare comp, const MergeInsertConfig& config);
+
+template <typename Storage, typename T>
+void mergeInsertSort(std::vector<T>& data, const MergeInsertConfig& config);
+
+template <typename Storage, typename T>
+void mergeInsertSort(std::deque<T>& data, const MergeInsertConfig& config);
+
+// Allocation-free sort on ArenaStorage: with config.arena reserved for at
+// least data.size() keys and spare.capacity() >= data.size(), no heap
+// allocation happens. The result is gathered into spare and swapped into
+// data, so spare comes back holding the old buffer for the next call.
+template <typename T, typename Compare>
+void mergeInsertSort(std::vector<T>& data, std::vector<T>& spare, Compare comp, const MergeInsertConfig& config);
+
+#include "MergeInsert.tpp"
+
+#endif
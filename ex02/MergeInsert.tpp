@@ -0,0 +1,819 @@
+#include <algorithm>
+#include <iterator>
+
+template <typename T>
+void ArenaStorage::Seq<T>::init(type& seq, size_t size, size_t capacity, const MergeInsertConfig& config)
+{
+	seq.attach(*config.arena, size, capacity);
+}
+
+namespace MergeInsertDetail
+{
+	// Orders positions of a key sequence by the keys they refer to
+	template <typename KeyIt, typename Compare>
+	struct PositionLess
+	{
+		KeyIt keys;
+		Compare comp;
+		SortStats* stats;
+
+		PositionLess(KeyIt k, const Compare& c, SortStats* s) : keys(k), comp(c), stats(s) {}
+		bool operator()(size_t a, size_t b) const
+		{
+			if (stats)
+				++stats->comparisons;
+			return comp(keys[a], keys[b]);
+		}
+	};
+
+	// Adds the time since the previous lap to one phase of the outermost level
+	class PhaseClock
+	{
+	private:
+		SortStats* _stats;
+		double _last;
+
+	public:
+		PhaseClock(SortStats* stats)
+			: _stats(stats && stats->depth == 0 ? stats : NULL), _last(_stats ? SortStats::now() : 0) {}
+
+		void lap(double SortStats::* phase)
+		{
+			if (!_stats)
+				return;
+			double t = SortStats::now();
+			_stats->*phase += t - _last;
+			_last = t;
+		}
+	};
+
+	// Binary search by rank over chain[0, hi) for the first element not less than value
+	template <typename Chain, typename Value, typename Less>
+	size_t lowerBoundRank(const Chain& chain, size_t hi, const Value& value, const Less& less)
+	{
+		size_t lo = 0;
+		
+		while (lo < hi)
+		{
+			size_t mid = lo + (hi - lo) / 2;
+			if (less(chain[mid], value))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+
+	template <typename Value, typename Less>
+	size_t lowerBoundRank(const BlockedChain<size_t>& chain, size_t hi, const Value& value, const Less& less)
+	{
+		return chain.lowerBound(hi, value, less);
+	}
+
+	// Insert value at rank; returns the number of elements written
+	inline size_t insertAt(std::vector<size_t>& chain, size_t rank, size_t value)
+	{
+		chain.insert(chain.begin() + rank, value);
+		return chain.size() - rank;
+	}
+
+	// std::deque shifts whichever side of rank is shorter
+	inline size_t insertAt(std::deque<size_t>& chain, size_t rank, size_t value)
+	{
+		size_t tail = chain.size() - rank;
+		chain.insert(chain.begin() + rank, value);
+		return (rank < tail ? rank : tail) + 1;
+	}
+
+	inline size_t insertAt(BlockedChain<size_t>& chain, size_t rank, size_t value)
+	{
+		return chain.insert(rank, value);
+	}
+
+	template <typename T>
+	size_t insertAt(ArenaSeq<T>& chain, size_t rank, const T& value)
+	{
+		chain.insert(rank, value);
+		return chain.size() - rank;
+	}
+
+	// Insert pend[1..] into the main chain in Jacobsthal order using binary search.
+	// pend[p] is known to be smaller than partners[p], so the search only covers
+	// the chain below that partner; the odd element past the last partner
+	// searches the whole chain. The partner's position is tracked as we go:
+	// at the start of a group every element inserted so far lies below it,
+	// and within a group (descending indices) we step down from the previous
+	// partner, passing each element at most once per group.
+	template <typename Chain, typename Pend, typename Partners, typename Order, typename Less>
+	void insertPend(Chain& mainChain, const Pend& pend, const Partners& partners,
+					const Order& insertionOrder, const Less& less)
+	{
+		size_t moves = 0;
+		size_t inserted = 0;
+		size_t prev = 0;
+		size_t partnerPos = 0;
+		size_t stragglerPos = 0;
+		
+		for (size_t j = 0; j < insertionOrder.size(); ++j)
+		{
+			size_t pendIndex = insertionOrder[j] + 1; // +1 because we already inserted pend[0]
+			size_t bound;
+			
+			if (pendIndex == partners.size())
+				bound = mainChain.size();
+			else
+			{
+				if (pendIndex > prev)
+					partnerPos = pendIndex + 1 + inserted;
+				else if (prev == partners.size())
+				{
+					partnerPos = pendIndex + inserted;
+					if (stragglerPos <= partnerPos)
+						++partnerPos;
+				}
+				else
+				{
+					--partnerPos;
+					while (mainChain[partnerPos] != partners[pendIndex])
+						--partnerPos;
+				}
+				bound = partnerPos;
+			}
+			
+			size_t pos = lowerBoundRank(mainChain, bound, pend[pendIndex], less);
+			moves += insertAt(mainChain, pos, pend[pendIndex]);
+			
+			if (pendIndex == partners.size())
+				stragglerPos = pos;
+			else
+				++partnerPos;
+			++inserted;
+			prev = pendIndex;
+		}
+		if (less.stats)
+			less.stats->moves += moves;
+	}
+
+	// Leaf: out[rank] = position for keys[0, n), ties kept in position order.
+	// Each pair j < i is compared once and ranks whichever is larger, the
+	// later one on a tie. Returns the number of comparisons made.
+	template <typename KeyIt, typename Compare>
+	unsigned long leafOrder(KeyIt keys, size_t n, size_t* out, const Compare& comp)
+	{
+		size_t rank[LeafSort::MAX_SIZE];
+		
+		for (size_t i = 0; i < n; ++i)
+			rank[i] = 0;
+		for (size_t i = 1; i < n; ++i)
+			for (size_t j = 0; j < i; ++j)
+				++rank[comp(keys[i], keys[j]) ? j : i];
+		for (size_t i = 0; i < n; ++i)
+			out[rank[i]] = i;
+		return n * (n - 1) / 2;
+	}
+
+	// int keys in ascending order use the vectorized rank sort
+	template <typename KeyIt>
+	unsigned long leafOrder(KeyIt keys, size_t n, size_t* out, const std::less<int>&)
+	{
+		int local[LeafSort::MAX_SIZE];
+		
+		for (size_t i = 0; i < n; ++i)
+			local[i] = keys[i];
+		LeafSort::rankOrder(local, n, out);
+		return n * (n - 1) / 2;
+	}
+
+	// Chunk sizes for the pool: pairs per pairing chunk, searches per group chunk
+	const size_t PAIR_GRAIN = 2048;
+	const size_t SEARCH_GRAIN = 64;
+
+	// Compare the members of pairs [begin, end), smaller member first
+	template <typename KeyIt, typename Compare, typename Keys, typename Positions>
+	class PairTask : public ThreadPool::Task
+	{
+	private:
+		KeyIt _keys;
+		const Compare& _comp;
+		Keys& _larger;
+		Positions& _largePos;
+		Positions& _smallPos;
+
+	public:
+		PairTask(KeyIt keys, const Compare& comp, Keys& larger, Positions& largePos, Positions& smallPos)
+			: _keys(keys), _comp(comp), _larger(larger), _largePos(largePos), _smallPos(smallPos) {}
+
+		void run(size_t begin, size_t end, size_t)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				size_t a = 2 * i;
+				size_t b = a + 1;
+				if (_comp(_keys[b], _keys[a]))
+					std::swap(a, b);
+				_larger[i] = _keys[b];
+				_largePos[i] = b;
+				_smallPos[i] = a;
+			}
+		}
+	};
+
+	// Search items[begin, end) of one group against the chain as it stood
+	// before the group; each worker counts into its own SortStats
+	template <typename KeyIt, typename Compare, typename Pend>
+	class GroupSearchTask : public ThreadPool::Task
+	{
+	private:
+		KeyIt _keys;
+		const Compare& _comp;
+		const std::vector<size_t>& _chain;
+		const Pend& _pend;
+		const std::vector<size_t>& _items;
+		const std::vector<size_t>& _bounds;
+		std::vector<size_t>& _ranks;
+		std::vector<SortStats>* _counters;
+
+	public:
+		GroupSearchTask(KeyIt keys, const Compare& comp, const std::vector<size_t>& chain, const Pend& pend,
+						const std::vector<size_t>& items, const std::vector<size_t>& bounds,
+						std::vector<size_t>& ranks, std::vector<SortStats>* counters)
+			: _keys(keys), _comp(comp), _chain(chain), _pend(pend), _items(items), _bounds(bounds),
+			  _ranks(ranks), _counters(counters) {}
+
+		void run(size_t begin, size_t end, size_t worker)
+		{
+			PositionLess<KeyIt, Compare> less(_keys, _comp, _counters ? &(*_counters)[worker] : NULL);
+			
+			for (size_t i = begin; i < end; ++i)
+				_ranks[i] = lowerBoundRank(_chain, _bounds[i], _pend[_items[i]], less);
+		}
+	};
+
+	// Orders group members by the rank they were found at
+	struct RankLess
+	{
+		const std::vector<size_t>& ranks;
+
+		RankLess(const std::vector<size_t>& r) : ranks(r) {}
+		bool operator()(size_t a, size_t b) const
+		{
+			return ranks[a] < ranks[b] || (ranks[a] == ranks[b] && a < b);
+		}
+	};
+
+	// Orders group members by their pend keys; equal keys keep member order
+	template <typename Pend, typename Less>
+	struct MemberLess
+	{
+		const Pend& pend;
+		const std::vector<size_t>& items;
+		Less less;
+
+		MemberLess(const Pend& p, const std::vector<size_t>& i, const Less& l) : pend(p), items(i), less(l) {}
+		bool operator()(size_t a, size_t b) const
+		{
+			return less(pend[items[a]], pend[items[b]]);
+		}
+	};
+
+	// Parallel counterpart of insertPend, one Jacobsthal group at a time.
+	// At the start of a group every element inserted so far lies below the
+	// partners of the whole group, so each member's partner sits at
+	// pendIndex + 1 + inserted and all members can be searched at once against
+	// the chain as it is. Members found at the same rank are then merge-sorted
+	// among themselves, and the group is spliced in with one pass over the
+	// chain.
+	template <typename Chain, typename Pend, typename Partners, typename Order,
+			  typename KeyIt, typename Compare>
+	void insertPendGroups(Chain& mainChain, const Pend& pend, const Partners& partners,
+						  const Order& insertionOrder, KeyIt keys, const Compare& comp,
+						  const MergeInsertConfig& config)
+	{
+		SortStats* stats = config.stats;
+		std::vector<SortStats> counters(stats ? config.pool->threads() : 0);
+		std::vector<size_t> chain;
+		std::vector<size_t> next;
+		std::vector<size_t> items;
+		std::vector<size_t> bounds;
+		std::vector<size_t> ranks;
+		std::vector<size_t> byRank;
+		size_t total = mainChain.size() + insertionOrder.size();
+		
+		chain.reserve(total);
+		next.reserve(total);
+		for (size_t i = 0; i < mainChain.size(); ++i)
+			chain.push_back(mainChain[i]);
+		
+		PositionLess<KeyIt, Compare> less(keys, comp, stats);
+		size_t inserted = 0;
+		size_t moves = 0;
+		size_t j = 0;
+		
+		while (j < insertionOrder.size())
+		{
+			// A group runs while the indices keep descending
+			items.clear();
+			bounds.clear();
+			do
+			{
+				size_t pendIndex = insertionOrder[j] + 1;
+				items.push_back(pendIndex);
+				bounds.push_back(pendIndex == partners.size() ? chain.size() : pendIndex + 1 + inserted);
+				++j;
+			}
+			while (j < insertionOrder.size() && insertionOrder[j] < insertionOrder[j - 1]);
+			
+			size_t groupSize = items.size();
+			ranks.resize(groupSize);
+			GroupSearchTask<KeyIt, Compare, Pend> search(keys, comp, chain, pend, items, bounds, ranks,
+														 stats ? &counters : NULL);
+			config.pool->parallelFor(groupSize, SEARCH_GRAIN, search);
+			
+			// Sort members by rank, then by key among equal ranks. A whole group
+			// can share one rank, so ties are merge-sorted: O(g log g)
+			// comparisons for g members, where insertion was O(g^2).
+			byRank.resize(groupSize);
+			for (size_t k = 0; k < groupSize; ++k)
+				byRank[k] = k;
+			std::sort(byRank.begin(), byRank.end(), RankLess(ranks));
+			MemberLess<Pend, PositionLess<KeyIt, Compare> > byKey(pend, items, less);
+			for (size_t k = 0; k < groupSize; )
+			{
+				size_t run = k + 1;
+				while (run < groupSize && ranks[byRank[run]] == ranks[byRank[k]])
+					++run;
+				if (run - k > 1)
+					std::stable_sort(byRank.begin() + k, byRank.begin() + run, byKey);
+				k = run;
+			}
+			
+			// Splice the group into the chain
+			next.clear();
+			size_t k = 0;
+			for (size_t pos = 0; pos <= chain.size(); ++pos)
+			{
+				while (k < groupSize && ranks[byRank[k]] == pos)
+					next.push_back(pend[items[byRank[k++]]]);
+				if (pos < chain.size())
+					next.push_back(chain[pos]);
+			}
+			chain.swap(next);
+			inserted += groupSize;
+			moves += chain.size();
+		}
+		
+		mainChain.clear();
+		for (size_t i = 0; i < chain.size(); ++i)
+			mainChain.push_back(chain[i]);
+		if (stats)
+		{
+			for (size_t w = 0; w < counters.size(); ++w)
+				stats->comparisons += counters[w].comparisons;
+			stats->moves += moves + 2 * chain.size();
+		}
+	}
+
+	// One level of Ford-Johnson merge-insertion over keys[0, n).
+	// Fills order with the positions of the keys in ascending order; order
+	// must have room for n elements and doubles as this level's main chain.
+	// Pairs are sorted by recursing on their larger members; each pair keeps
+	// the positions of both members, so every pend element is still matched
+	// to its partner.
+	template <typename Storage, typename KeyIt, typename Compare>
+	void mergeInsertLevel(KeyIt keys, size_t n, typename Storage::template Seq<size_t>::type& order,
+						  const Compare& comp, const MergeInsertConfig& config)
+	{
+		typedef typename std::iterator_traits<KeyIt>::value_type T;
+		typedef typename Storage::template Seq<T> KeySeq;
+		typedef typename Storage::template Seq<size_t> PosSeq;
+		
+		SortStats* stats = config.stats;
+		PhaseClock clock(stats);
+		bool parallel = config.pool && n >= config.parallelThreshold;
+		
+		order.clear();
+		if (n == 0)
+			return;
+		if (n == 1)
+		{
+			order.push_back(0);
+			return;
+		}
+		if (n <= config.leafSize && n <= LeafSort::MAX_SIZE)
+		{
+			size_t leaf[LeafSort::MAX_SIZE];
+			unsigned long comparisons = leafOrder(keys, n, leaf, comp);
+			
+			for (size_t i = 0; i < n; ++i)
+				order.push_back(leaf[i]);
+			if (stats)
+			{
+				stats->comparisons += comparisons;
+				stats->moves += n;
+			}
+			clock.lap(&SortStats::insertionTime);
+			return;
+		}
+		
+		// Create pairs: one comparison each, smaller member first
+		size_t pairCount = n / 2;
+		typename KeySeq::type larger;
+		typename PosSeq::type largePos;
+		typename PosSeq::type smallPos;
+		KeySeq::init(larger, pairCount, pairCount, config);
+		PosSeq::init(largePos, pairCount, pairCount, config);
+		PosSeq::init(smallPos, pairCount, pairCount, config);
+		
+		PairTask<KeyIt, Compare, typename KeySeq::type, typename PosSeq::type>
+			pairing(keys, comp, larger, largePos, smallPos);
+		if (parallel)
+			config.pool->parallelFor(pairCount, PAIR_GRAIN, pairing);
+		else
+			pairing.run(0, pairCount, 0);
+		if (stats)
+		{
+			stats->comparisons += pairCount;
+			stats->moves += 3 * pairCount;
+		}
+		clock.lap(&SortStats::pairingTime);
+		
+		// Sort pairs by their larger element with the same algorithm
+		typename PosSeq::type pairOrder;
+		PosSeq::init(pairOrder, 0, pairCount, config);
+		if (stats)
+			++stats->depth;
+		mergeInsertLevel<Storage>(KeySeq::keys(larger), pairCount, pairOrder, comp, config);
+		if (stats)
+			--stats->depth;
+		
+		// Build pend (smaller elements) and their partners (larger elements)
+		typename PosSeq::type partners;
+		typename PosSeq::type pend;
+		PosSeq::init(partners, pairCount, pairCount, config);
+		PosSeq::init(pend, pairCount + n % 2, pairCount + 1, config);
+		
+		for (size_t j = 0; j < pairCount; ++j)
+		{
+			partners[j] = largePos[pairOrder[j]];
+			pend[j] = smallPos[pairOrder[j]];
+		}
+		
+		// Handle odd element: it goes last in pend and has no partner
+		if (n % 2 != 0)
+			pend[pairCount] = n - 1;
+		
+		// Main chain: first pend element (it's always smaller than its partner), then all partners
+		typename PosSeq::type& mainChain = order;
+		mainChain.push_back(pend[0]);
+		for (size_t j = 0; j < pairCount; ++j)
+			mainChain.push_back(partners[j]);
+		if (stats)
+			stats->moves += partners.size() + pend.size() + mainChain.size();
+		clock.lap(&SortStats::recursionTime);
+		
+		// Optimal Jacobsthal-based insertion order for remaining pend elements
+		JacobsthalOrder::View insertionOrder = config.jacobsthal->view(pend.size() - 1);
+		clock.lap(&SortStats::jacobsthalTime);
+		
+		// Insert remaining pend elements in optimal order using binary search
+		PositionLess<KeyIt, Compare> less(keys, comp, stats);
+		if (parallel)
+			insertPendGroups(mainChain, pend, partners, insertionOrder, keys, comp, config);
+		else if (config.blockedChain || Storage::chunkedChain)
+		{
+			BlockedChain<size_t> localChain;
+			BlockedChain<size_t>& chain = config.arena ? config.arena->chain() : localChain;
+			chain.reset(n);
+			for (size_t j = 0; j < mainChain.size(); ++j)
+				chain.push_back(mainChain[j]);
+			insertPend(chain, pend, partners, insertionOrder, less);
+			chain.copyTo(mainChain);
+			if (stats)
+				stats->moves += 2 * n;
+		}
+		else
+			insertPend(mainChain, pend, partners, insertionOrder, less);
+		clock.lap(&SortStats::insertionTime);
+	}
+
+	// Orders keys themselves, for the run merge
+	template <typename Compare>
+	struct KeyLess
+	{
+		Compare comp;
+		SortStats* stats;
+
+		KeyLess(const Compare& c, SortStats* s) : comp(c), stats(s) {}
+		template <typename T>
+		bool operator()(const T& a, const T& b) const
+		{
+			if (stats)
+				++stats->comparisons;
+			return comp(a, b);
+		}
+	};
+
+	// Paths the adaptive pre-pass picks between
+	enum Path
+	{
+		PATH_SORTED,
+		PATH_REVERSED,
+		PATH_RUNS,
+		PATH_MERGE_INSERT
+	};
+
+	// Shortest average run the run merge is taken for: log2(n / 8) merge
+	// passes stay below the ~log2(n) - 1.4 comparisons per key of Ford-Johnson
+	const size_t MIN_RUN_LENGTH = 8;
+
+	// Capacity the run starts need: one per run plus the end sentinel
+	inline size_t runCapacity(size_t n)
+	{
+		return n / MIN_RUN_LENGTH + 2;
+	}
+
+	// Pre-pass: splits keys into maximal runs that either never descend or
+	// strictly descend, at one comparison per adjacent pair plus one per run,
+	// and records where they start while they still fit the run merge.
+	// Unless Ford-Johnson is chosen, starts ends with n as a sentinel.
+	template <typename KeyIt, typename Starts, typename Compare>
+	Path choosePath(KeyIt keys, size_t n, Starts& starts, const Compare& comp, SortStats* stats)
+	{
+		size_t maxRuns = n / MIN_RUN_LENGTH;
+		size_t runs = 0;
+		size_t comparisons = 0;
+		bool firstDescending = false;
+		
+		starts.clear();
+		for (size_t start = 0; start < n; ++runs)
+		{
+			if (runs < maxRuns || runs == 0)
+				starts.push_back(start);
+			
+			size_t end = start + 1;
+			bool descending = false;
+			if (end < n)
+			{
+				descending = comp(keys[end], keys[start]);
+				++comparisons;
+				for (++end; end < n; ++end)
+				{
+					++comparisons;
+					if (comp(keys[end], keys[end - 1]) != descending)
+						break;
+				}
+			}
+			if (runs == 0)
+				firstDescending = descending;
+			start = end;
+		}
+		
+		Path path = PATH_MERGE_INSERT;
+		if (runs == 1)
+			path = firstDescending ? PATH_REVERSED : PATH_SORTED;
+		else if (runs <= maxRuns)
+			path = PATH_RUNS;
+		if (path != PATH_MERGE_INSERT)
+			starts.push_back(n);
+		if (stats)
+		{
+			static const char* const names[] = { "sorted", "reversed", "run merge", "merge-insert" };
+			stats->comparisons += comparisons;
+			stats->runs = runs;
+			stats->path = names[path];
+		}
+		return path;
+	}
+
+	// Turn the strictly descending runs between starts around so every run
+	// ascends; a run's first pair tells which way it goes
+	template <typename Seq, typename Starts, typename Less>
+	void orientRuns(Seq& seq, const Starts& starts, const Less& less)
+	{
+		size_t moves = 0;
+		
+		for (size_t r = 0; r + 1 < starts.size(); ++r)
+		{
+			size_t lo = starts[r];
+			size_t hi = starts[r + 1] - 1;
+			
+			if (hi > lo && less(seq[lo + 1], seq[lo]))
+			{
+				moves += hi - lo + 1;
+				for (; lo < hi; ++lo, --hi)
+					std::swap(seq[lo], seq[hi]);
+			}
+		}
+		if (less.stats)
+			less.stats->moves += moves;
+	}
+
+	// Merge adjacent runs pairwise, back and forth between a and b, until one
+	// is left. starts[0, runs] holds the run starts and the n sentinel.
+	// Returns true when the result ended up in b.
+	template <typename Seq, typename Starts, typename Less>
+	bool mergeRuns(Seq& a, Seq& b, Starts& starts, const Less& less)
+	{
+		size_t runs = starts.size() - 1;
+		size_t n = starts[runs];
+		bool inB = false;
+		
+		while (runs > 1)
+		{
+			Seq& from = inB ? b : a;
+			Seq& to = inB ? a : b;
+			size_t merged = 0;
+			
+			for (size_t r = 0; r < runs; r += 2)
+			{
+				size_t i = starts[r];
+				size_t mid = starts[r + 1];
+				size_t end = r + 2 <= runs ? starts[r + 2] : mid;
+				size_t k = i;
+				size_t j = mid;
+				
+				while (i < mid && j < end)
+					to[k++] = less(from[j], from[i]) ? from[j++] : from[i++];
+				while (i < mid)
+					to[k++] = from[i++];
+				while (j < end)
+					to[k++] = from[j++];
+				starts[merged++] = starts[r];
+			}
+			starts[merged] = n;
+			runs = merged;
+			inB = !inB;
+			if (less.stats)
+				less.stats->moves += n;
+		}
+		return inB;
+	}
+
+	// Make sure the insertion orders of every level are cached, falling back
+	// to local when the caller did not supply a JacobsthalOrder
+	inline MergeInsertConfig withOrder(const MergeInsertConfig& config, JacobsthalOrder& local, size_t n)
+	{
+		MergeInsertConfig prepared(config);
+		
+		if (!prepared.jacobsthal)
+			prepared.jacobsthal = &local;
+		prepared.jacobsthal->reserve(n / 2 + 1);
+		return prepared;
+	}
+
+	// Adaptive front end of sortInto: false when the input needs Ford-Johnson.
+	// Otherwise the runs are turned ascending and merged in a copy, since
+	// out may alias keys.
+	template <typename Storage, typename KeyIt, typename OutIt, typename Compare>
+	bool sortPresorted(KeyIt keys, size_t n, OutIt out, const Compare& comp, const MergeInsertConfig& config)
+	{
+		typedef typename std::iterator_traits<KeyIt>::value_type T;
+		typedef typename Storage::template Seq<T> KeySeq;
+		typedef typename Storage::template Seq<size_t> PosSeq;
+		
+		SortStats* stats = config.stats;
+		PhaseClock clock(stats);
+		typename PosSeq::type starts;
+		PosSeq::init(starts, 0, runCapacity(n), config);
+		Path path = choosePath(keys, n, starts, comp, stats);
+		clock.lap(&SortStats::presortTime);
+		
+		if (path == PATH_MERGE_INSERT)
+			return false;
+		if (path == PATH_SORTED)
+		{
+			for (size_t i = 0; i < n; ++i, ++out)
+				*out = keys[i];
+			return true;
+		}
+		
+		KeyLess<Compare> less(comp, stats);
+		typename KeySeq::type sorted;
+		typename KeySeq::type spare;
+		KeySeq::init(sorted, n, n, config);
+		KeySeq::init(spare, path == PATH_RUNS ? n : 0, path == PATH_RUNS ? n : 0, config);
+		for (size_t i = 0; i < n; ++i)
+			sorted[i] = keys[i];
+		orientRuns(sorted, starts, less);
+		
+		typename KeySeq::type& result = mergeRuns(sorted, spare, starts, less) ? spare : sorted;
+		for (size_t i = 0; i < n; ++i, ++out)
+			*out = result[i];
+		if (stats)
+			stats->moves += 2 * n;
+		clock.lap(&SortStats::insertionTime);
+		return true;
+	}
+
+	// Sort keys[0, n) and write the result through out
+	template <typename Storage, typename KeyIt, typename OutIt, typename Compare>
+	void sortInto(KeyIt keys, size_t n, OutIt out, const Compare& comp, const MergeInsertConfig& userConfig)
+	{
+		JacobsthalOrder localOrder;
+		MergeInsertConfig config = withOrder(userConfig, localOrder, n);
+		
+		typedef typename std::iterator_traits<KeyIt>::value_type T;
+		typedef typename Storage::template Seq<T> KeySeq;
+		typedef typename Storage::template Seq<size_t> PosSeq;
+		
+		if (config.adaptive && n > 1 && sortPresorted<Storage>(keys, n, out, comp, config))
+			return;
+		
+		typename PosSeq::type order;
+		PosSeq::init(order, 0, n, config);
+		mergeInsertLevel<Storage>(keys, n, order, comp, config);
+		
+		PhaseClock clock(config.stats);
+		typename KeySeq::type sorted;
+		KeySeq::init(sorted, n, n, config);
+		for (size_t i = 0; i < n; ++i)
+			sorted[i] = keys[order[i]];
+		for (size_t i = 0; i < n; ++i, ++out)
+			*out = sorted[i];
+		if (config.stats)
+			config.stats->moves += 2 * n;
+		clock.lap(&SortStats::insertionTime);
+	}
+}
+
+template <typename Storage, typename RandomIt, typename Compare>
+void mergeInsertSort(RandomIt first, RandomIt last, Compare comp, const MergeInsertConfig& config)
+{
+	MergeInsertDetail::sortInto<Storage>(first, last - first, first, comp, config);
+}
+
+template <typename Storage, typename T, typename Compare>
+void mergeInsertSort(T* first, T* last, Compare comp, const MergeInsertConfig& config)
+{
+	MergeInsertDetail::sortInto<Storage, const T*>(first, last - first, first, comp, config);
+}
+
+template <typename Storage, typename T, typename Compare>
+void mergeInsertSort(std::vector<T>& data, Compare comp, const MergeInsertConfig& config)
+{
+	if (!data.empty())
+		mergeInsertSort<Storage>(&data[0], &data[0] + data.size(), comp, config);
+}
+
+template <typename Storage, typename T>
+void mergeInsertSort(std::vector<T>& data, const MergeInsertConfig& config)
+{
+	mergeInsertSort<Storage>(data, std::less<T>(), config);
+}
+
+template <typename Storage, typename T>
+void mergeInsertSort(std::deque<T>& data, const MergeInsertConfig& config)
+{
+	mergeInsertSort<Storage>(data.begin(), data.end(), std::less<T>(), config);
+}
+
+template <typename T, typename Compare>
+void mergeInsertSort(std::vector<T>& data, std::vector<T>& spare, Compare comp, const MergeInsertConfig& userConfig)
+{
+	size_t n = data.size();
+	if (n == 0)
+		return;
+	
+	JacobsthalOrder localOrder;
+	MergeInsertConfig config = MergeInsertDetail::withOrder(userConfig, localOrder, n);
+	
+	// Adaptive paths work in place or between data and spare
+	if (config.adaptive && n > 1)
+	{
+		MergeInsertDetail::PhaseClock clock(config.stats);
+		ArenaSeq<size_t> starts;
+		ArenaStorage::Seq<size_t>::init(starts, 0, MergeInsertDetail::runCapacity(n), config);
+		MergeInsertDetail::Path path = MergeInsertDetail::choosePath(&data[0], n, starts, comp, config.stats);
+		clock.lap(&SortStats::presortTime);
+		
+		if (path != MergeInsertDetail::PATH_MERGE_INSERT)
+		{
+			MergeInsertDetail::KeyLess<Compare> less(comp, config.stats);
+			if (path != MergeInsertDetail::PATH_SORTED)
+				MergeInsertDetail::orientRuns(data, starts, less);
+			if (path == MergeInsertDetail::PATH_RUNS)
+			{
+				spare.resize(n);
+				if (MergeInsertDetail::mergeRuns(data, spare, starts, less))
+					data.swap(spare);
+			}
+			clock.lap(&SortStats::insertionTime);
+			return;
+		}
+	}
+	
+	const T* keys = &data[0];
+	ArenaSeq<size_t> order;
+	ArenaStorage::Seq<size_t>::init(order, 0, n, config);
+	MergeInsertDetail::mergeInsertLevel<ArenaStorage>(keys, n, order, comp, config);
+	
+	// Gather into the spare buffer and hand it over instead of copying back
+	MergeInsertDetail::PhaseClock clock(config.stats);
+	spare.resize(n);
+	for (size_t i = 0; i < n; ++i)
+		spare[i] = keys[order[i]];
+	data.swap(spare);
+	if (config.stats)
+		config.stats->moves += n;
+	clock.lap(&SortStats::insertionTime);
+}
@@ -0,0 +1,259 @@
+#include "PackedSort.hpp"
+#include "MergeInsert.hpp"
+#include <stdexcept>
+
+#if !defined(PMERGEME_NO_SIMD) && defined(__AVX2__)
+# define PACKED_AVX2
+# include <immintrin.h>
+#endif
+
+using PackedSort::Word;
+
+namespace
+{
+	const Word KEY_MASK = 0xFFFFFFFF00000000ULL;
+	const Word POS_MASK = 0x00000000FFFFFFFFULL;
+	const Word SIGN_BIT = 0x8000000000000000ULL;
+
+	Word pack(int key, size_t pos)
+	{
+		return (static_cast<Word>(static_cast<unsigned int>(key) ^ 0x80000000u) << 32) | pos;
+	}
+
+	int unpack(Word word)
+	{
+		return static_cast<int>(static_cast<unsigned int>(word >> 32) ^ 0x80000000u);
+	}
+
+	// Word order, counted like PositionLess
+	struct WordLess
+	{
+		SortStats* stats;
+
+		WordLess(SortStats* s) : stats(s) {}
+		bool operator()(Word a, Word b) const
+		{
+			if (stats)
+				++stats->comparisons;
+			return a < b;
+		}
+	};
+
+#if defined(PACKED_AVX2)
+
+	// Four pairs at a time: split members into two registers, compare, and
+	// put the pairs back in order (unpacking interleaves them as 0, 2, 1, 3)
+	void pairUp(const Word* words, size_t pairs, Word* larger, Word* smaller)
+	{
+		const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(SIGN_BIT));
+		const __m256i keyMask = _mm256_set1_epi64x(static_cast<long long>(KEY_MASK));
+		const __m256i step = _mm256_set1_epi64x(4);
+		__m256i index = _mm256_setr_epi64x(0, 1, 2, 3);
+		size_t i = 0;
+		
+		for (; i + 4 <= pairs; i += 4)
+		{
+			__m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + 2 * i));
+			__m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + 2 * i + 4));
+			__m256i a = _mm256_unpacklo_epi64(v0, v1);
+			__m256i b = _mm256_unpackhi_epi64(v0, v1);
+			
+			// Unsigned b < a through a signed compare
+			__m256i bLess = _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+			__m256i lo = _mm256_blendv_epi8(a, b, bLess);
+			__m256i hi = _mm256_blendv_epi8(b, a, bLess);
+			lo = _mm256_permute4x64_epi64(lo, _MM_SHUFFLE(3, 1, 2, 0));
+			hi = _mm256_permute4x64_epi64(hi, _MM_SHUFFLE(3, 1, 2, 0));
+			
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(smaller + i), lo);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(larger + i),
+				_mm256_or_si256(_mm256_and_si256(hi, keyMask), index));
+			index = _mm256_add_epi64(index, step);
+		}
+		for (; i < pairs; ++i)
+		{
+			Word a = words[2 * i];
+			Word b = words[2 * i + 1];
+			Word lo = b < a ? b : a;
+			smaller[i] = lo;
+			larger[i] = ((a ^ b ^ lo) & KEY_MASK) | i;
+		}
+	}
+
+#else
+
+	void pairUp(const Word* words, size_t pairs, Word* larger, Word* smaller)
+	{
+		for (size_t i = 0; i < pairs; ++i)
+		{
+			Word a = words[2 * i];
+			Word b = words[2 * i + 1];
+			Word lo = b < a ? b : a;
+			smaller[i] = lo;
+			larger[i] = ((a ^ b ^ lo) & KEY_MASK) | i;
+		}
+	}
+
+#endif
+
+	// One level over words[0, n), each holding its position i in the low
+	// half; sorts them in place. The larger member of each pair is carried
+	// down re-packed with the pair's index, so after the recursion each one
+	// finds its smaller partner directly, and the partner's own word is the
+	// key with the other position of the pair.
+	void level(ArenaSeq<Word>& words, const MergeInsertConfig& config)
+	{
+		using namespace MergeInsertDetail;
+		
+		SortStats* stats = config.stats;
+		PhaseClock clock(stats);
+		ScratchArena& arena = *config.arena;
+		size_t n = words.size();
+		
+		if (n < 2)
+			return;
+		if (n <= config.leafSize && n <= LeafSort::MAX_SIZE)
+		{
+			// Words are distinct, so a key's rank is the count of smaller words
+			Word leaf[LeafSort::MAX_SIZE];
+			for (size_t i = 0; i < n; ++i)
+			{
+				size_t rank = 0;
+				for (size_t j = 0; j < n; ++j)
+					rank += words[j] < words[i];
+				leaf[rank] = words[i];
+			}
+			for (size_t i = 0; i < n; ++i)
+				words[i] = leaf[i];
+			if (stats)
+			{
+				stats->comparisons += n * (n - 1) / 2;
+				stats->moves += 2 * n;
+			}
+			clock.lap(&SortStats::insertionTime);
+			return;
+		}
+		
+		size_t pairCount = n / 2;
+		ArenaSeq<Word> larger;
+		ArenaSeq<Word> smaller;
+		larger.attach(arena, pairCount, pairCount);
+		smaller.attach(arena, pairCount, pairCount);
+		pairUp(words.data(), pairCount, larger.data(), smaller.data());
+		if (stats)
+		{
+			stats->comparisons += pairCount;
+			stats->moves += 2 * pairCount;
+		}
+		clock.lap(&SortStats::pairingTime);
+		
+		if (stats)
+			++stats->depth;
+		level(larger, config);
+		if (stats)
+			--stats->depth;
+		
+		// Pend and partners in the order of the sorted larger members
+		ArenaSeq<Word> partners;
+		ArenaSeq<Word> pend;
+		partners.attach(arena, pairCount, pairCount);
+		pend.attach(arena, pairCount + n % 2, pairCount + 1);
+		for (size_t j = 0; j < pairCount; ++j)
+		{
+			Word small = smaller[larger[j] & POS_MASK];
+			pend[j] = small;
+			partners[j] = (larger[j] & KEY_MASK) | ((small & POS_MASK) ^ 1);
+		}
+		if (n % 2 != 0)
+			pend[pairCount] = words[n - 1];
+		
+		// The main chain replaces this level's words
+		words.clear();
+		words.push_back(pend[0]);
+		for (size_t j = 0; j < pairCount; ++j)
+			words.push_back(partners[j]);
+		if (stats)
+			stats->moves += partners.size() + pend.size() + words.size();
+		clock.lap(&SortStats::recursionTime);
+		
+		JacobsthalOrder::View insertionOrder = config.jacobsthal->view(pend.size() - 1);
+		clock.lap(&SortStats::jacobsthalTime);
+		
+		insertPend(words, pend, partners, insertionOrder, WordLess(stats));
+		clock.lap(&SortStats::insertionTime);
+	}
+
+	// Pack, sort and unpack keys[0, n) in place
+	template <typename It>
+	void sortRange(It keys, size_t n, ScratchArena& arena, const MergeInsertConfig& userConfig)
+	{
+		using namespace MergeInsertDetail;
+		
+		if (n < 2)
+			return;
+		if (n > POS_MASK)
+			throw std::length_error("PackedSort: too many keys");
+		
+		JacobsthalOrder localOrder;
+		MergeInsertConfig config = withOrder(userConfig, localOrder, n);
+		config.arena = &arena;
+		SortStats* stats = config.stats;
+		
+		ArenaSeq<Word> words;
+		words.attach(arena, n, n);
+		for (size_t i = 0; i < n; ++i)
+			words[i] = pack(keys[i], i);
+		if (stats)
+			stats->moves += n;
+		
+		// Words are distinct, so descending runs are strictly descending
+		bool sorted = false;
+		if (config.adaptive)
+		{
+			PhaseClock clock(stats);
+			ArenaSeq<size_t> starts;
+			starts.attach(arena, 0, runCapacity(n));
+			Path path = choosePath(words.data(), n, starts, std::less<Word>(), stats);
+			clock.lap(&SortStats::presortTime);
+			
+			if (path != PATH_MERGE_INSERT)
+			{
+				WordLess less(stats);
+				ArenaSeq<Word> spare;
+				spare.attach(arena, n, n);
+				orientRuns(words, starts, less);
+				if (mergeRuns(words, spare, starts, less))
+					for (size_t i = 0; i < n; ++i)
+						words[i] = spare[i];
+				clock.lap(&SortStats::insertionTime);
+				sorted = true;
+			}
+		}
+		if (!sorted)
+			level(words, config);
+		
+		for (size_t i = 0; i < n; ++i, ++keys)
+			*keys = unpack(words[i]);
+		if (stats)
+			stats->moves += n;
+	}
+}
+
+void PackedSort::sort(int* data, size_t n, ScratchArena& arena, const MergeInsertConfig& config)
+{
+	sortRange(data, n, arena, config);
+}
+
+void PackedSort::sort(std::deque<int>& data, ScratchArena& arena, const MergeInsertConfig& config)
+{
+	sortRange(data.begin(), data.size(), arena, config);
+}
+
+const char* PackedSort::kind()
+{
+#if defined(PACKED_AVX2)
+	return "avx2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,32 @@
+#ifndef PACKEDSORT_HPP
+#define PACKEDSORT_HPP
+
+#include <cstddef>
+#include <deque>
+
+#include "ScratchArena.hpp"
+
+struct MergeInsertConfig;
+
+// Ford-Johnson over int keys packed with their position at each level into
+// one 64-bit word: the key (sign-flipped) in the high half, the position in
+// the low half. Plain integer order on words is key order, and a word
+// carries its own identity, so every level's pairs, pend and main chain are
+// word arrays compared directly instead of position arrays read through the
+// keys. Pairing is one branch-free min/max pass, on AVX2 when the build
+// targets it (SIMD= in the Makefile).
+//
+// All working arrays come from arena as in ArenaStorage; reserve(n,
+// sizeof(Word)) covers a sort of n keys. Inputs must have fewer than 2^32 keys.
+namespace PackedSort
+{
+	typedef unsigned long long Word;
+
+	void sort(int* data, size_t n, ScratchArena& arena, const MergeInsertConfig& config);
+	void sort(std::deque<int>& data, ScratchArena& arena, const MergeInsertConfig& config);
+
+	// "avx2" or "scalar" pairing pass
+	const char* kind();
+}
+
+#endif
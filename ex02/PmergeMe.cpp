@@ -1,16 +1,35 @@
 #include "PmergeMe.hpp"
+#include "MergeInsert.hpp"
+#include "SortStats.hpp"
+#include "PackedSort.hpp"
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include <ctime>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <iomanip>
+#include <sstream>
 
 // Orthodox Canonical Form
-PmergeMe::PmergeMe() {}
+PmergeMe::PmergeMe()
+	: _keyType(KEY_INT), _records(false), _blockedChain(false), _collectStats(false), _useArena(false),
+	  _minimalLeaf(false), _adaptive(false), _packed(false), _parallelThreads(0),
+	  _parallelThreshold(MergeInsertConfig().parallelThreshold) {}
 
 PmergeMe::PmergeMe(const PmergeMe& other) 
-	: _vectorData(other._vectorData), _dequeData(other._dequeData) {}
+	: _vectorData(other._vectorData), _dequeData(other._dequeData), _int64(other._int64),
+	  _uint64(other._uint64), _intRecords(other._intRecords), _int64Records(other._int64Records),
+	  _uint64Records(other._uint64Records), _keyType(other._keyType), _records(other._records),
+	  _blockedChain(other._blockedChain), _collectStats(other._collectStats),
+	  _useArena(other._useArena), _minimalLeaf(other._minimalLeaf), _adaptive(other._adaptive),
+	  _packed(other._packed), _parallelThreads(other._parallelThreads),
+	  _parallelThreshold(other._parallelThreshold), _arena(other._arena), _spare(other._spare),
+	  _jacobsthal(other._jacobsthal) {}
 
 PmergeMe& PmergeMe::operator=(const PmergeMe& other)
 {
@@ -18,369 +37,545 @@ PmergeMe& PmergeMe::operator=(const PmergeMe& other)
 	{
 		_vectorData = other._vectorData;
 		_dequeData = other._dequeData;
+		_int64 = other._int64;
+		_uint64 = other._uint64;
+		_intRecords = other._intRecords;
+		_int64Records = other._int64Records;
+		_uint64Records = other._uint64Records;
+		_keyType = other._keyType;
+		_records = other._records;
+		_blockedChain = other._blockedChain;
+		_collectStats = other._collectStats;
+		_useArena = other._useArena;
+		_minimalLeaf = other._minimalLeaf;
+		_adaptive = other._adaptive;
+		_packed = other._packed;
+		_parallelThreads = other._parallelThreads;
+		_parallelThreshold = other._parallelThreshold;
+		_arena = other._arena;
+		_spare = other._spare;
+		_jacobsthal = other._jacobsthal;
 	}
 	return *this;
 }
 
 PmergeMe::~PmergeMe() {}
 
-// Generate Jacobsthal number: J(n) = J(n-1) + 2*J(n-2), J(0)=0, J(1)=1
-// Sequence: 0, 1, 1, 3, 5, 11, 21, 43, 85, 171, 341, ...
-size_t PmergeMe::jacobsthal(size_t n) const
+namespace
 {
-	if (n == 0) return 0;
-	if (n == 1) return 1;
-	
-	size_t prev2 = 0;
-	size_t prev1 = 1;
-	size_t current = 1;
-	
-	for (size_t i = 2; i <= n; ++i)
+	// Byte classes for the number parser
+	enum CharClass
 	{
-		current = prev1 + 2 * prev2;
-		prev2 = prev1;
-		prev1 = current;
-	}
-	
-	return current;
-}
+		SEPARATOR = 0,
+		DIGIT = 1,
+		INVALID = 2
+	};
 
-// Generate optimal insertion order based on Jacobsthal numbers
-// This minimizes the number of comparisons needed
-void PmergeMe::generateJacobsthalInsertionOrder(size_t pendSize, std::vector<size_t>& order) const
-{
-	if (pendSize == 0)
-		return;
-	
-	order.clear();
-	std::vector<bool> inserted(pendSize, false);
-	
-	// Calculate Jacobsthal numbers we'll need
-	std::vector<size_t> jacobsthalNums;
-	size_t index = 3; // Start from J(3) = 3
-	while (true)
+	const unsigned long MAX_VALUE = 2147483647;
+
+	struct CharClasses
 	{
-		size_t jNum = jacobsthal(index);
-		if (jNum >= pendSize)
+		unsigned char table[256];
+
+		CharClasses()
 		{
-			jacobsthalNums.push_back(pendSize - 1);
-			break;
+			for (int c = 0; c < 256; ++c)
+				table[c] = INVALID;
+			for (int c = '0'; c <= '9'; ++c)
+				table[c] = DIGIT;
+			table[static_cast<unsigned char>(' ')] = SEPARATOR;
+			table[static_cast<unsigned char>('\t')] = SEPARATOR;
+			table[static_cast<unsigned char>('\n')] = SEPARATOR;
+			table[static_cast<unsigned char>('\r')] = SEPARATOR;
 		}
-		jacobsthalNums.push_back(jNum);
-		++index;
-	}
-	
-	// Insert elements in groups defined by Jacobsthal numbers
-	// Within each group, insert from highest to lowest index
-	size_t prevJacob = 0;
-	
-	for (size_t i = 0; i < jacobsthalNums.size(); ++i)
+	};
+
+	const CharClasses g_classes;
+
+	// One pass over a token: digits only, value in [1, 2147483647].
+	// Invalid bytes are or-ed into a flag and the value saturates just past
+	// the limit, so the loop has no early exits.
+	bool parseNumber(const unsigned char* p, const unsigned char* end, int& out)
 	{
-		size_t currentJacob = jacobsthalNums[i];
+		unsigned int classes = DIGIT;
+		unsigned long value = 0;
 		
-		// Insert from currentJacob down to prevJacob+1
-		for (size_t j = currentJacob; j > prevJacob; --j)
+		if (p == end)
+			return false;
+		for (; p < end; ++p)
 		{
-			if (j < pendSize && !inserted[j])
-			{
-				order.push_back(j);
-				inserted[j] = true;
-			}
+			classes |= g_classes.table[*p];
+			value = value * 10 + (*p - '0');
+			value = value > MAX_VALUE ? MAX_VALUE + 1 : value;
 		}
-		
-		prevJacob = currentJacob;
+		if (classes != DIGIT || value == 0 || value > MAX_VALUE)
+			return false;
+		out = static_cast<int>(value);
+		return true;
 	}
 	
-	// Insert any remaining elements
-	for (size_t i = 0; i < pendSize; ++i)
+	// 64-bit keys take the whole range of their type, 0 included, with a
+	// leading '-' for signed ones. Overflow is or-ed into a flag like the
+	// invalid bytes.
+	bool parseNumber(const unsigned char* p, const unsigned char* end, unsigned long long& out)
 	{
-		if (!inserted[i])
-			order.push_back(i);
+		const unsigned long long max = ~0ULL;
+		unsigned int classes = DIGIT;
+		unsigned long long value = 0;
+		bool overflow = false;
+		
+		if (p == end)
+			return false;
+		for (; p < end; ++p)
+		{
+			unsigned int digit = *p - '0';
+			classes |= g_classes.table[*p];
+			overflow |= value > (max - digit) / 10;
+			value = value * 10 + digit;
+		}
+		if (classes != DIGIT || overflow)
+			return false;
+		out = value;
+		return true;
 	}
-}
 
-// Validation
-bool PmergeMe::isValidNumber(const std::string& str) const
-{
-	if (str.empty())
-		return false;
-	
-	for (size_t i = 0; i < str.length(); ++i)
+	bool parseNumber(const unsigned char* p, const unsigned char* end, long long& out)
 	{
-		if (!isdigit(str[i]))
+		const unsigned long long max = 9223372036854775807ULL;
+		bool negative = p < end && *p == '-';
+		unsigned long long magnitude;
+		
+		if (!parseNumber(p + negative, end, magnitude) || magnitude > max + negative)
 			return false;
+		if (negative && magnitude != 0)
+			out = -static_cast<long long>(magnitude - 1) - 1;
+		else
+			out = static_cast<long long>(magnitude);
+		return true;
 	}
-	
-	// Check for positive integer
-	long num = atol(str.c_str());
-	if (num <= 0 || num > 2147483647)
-		return false;
-	
-	return true;
-}
 
-bool PmergeMe::parseInput(int argc, char** argv)
-{
-	if (argc < 2)
+	// key:payload, the payload an unsigned 64-bit number
+	template <typename K>
+	bool parseNumber(const unsigned char* p, const unsigned char* end, Record<K>& out)
 	{
-		std::cerr << "Error: no input provided" << std::endl;
-		return false;
+		const unsigned char* colon = static_cast<const unsigned char*>(std::memchr(p, ':', end - p));
+		
+		return colon && parseNumber(p, colon, out.key) && parseNumber(colon + 1, end, out.payload);
 	}
-	
-	for (int i = 1; i < argc; ++i)
+
+	// One element per argument
+	template <typename T>
+	bool parseArgs(int argc, char** argv, std::vector<T>& vectorData, std::deque<T>& dequeData)
 	{
-		std::string arg(argv[i]);
-		
-		if (!isValidNumber(arg))
+		vectorData.reserve(vectorData.size() + argc - 1);
+		for (int i = 1; i < argc; ++i)
 		{
-			std::cerr << "Error" << std::endl;
-			return false;
+			const unsigned char* arg = reinterpret_cast<const unsigned char*>(argv[i]);
+			T num;
+			
+			if (!parseNumber(arg, arg + strlen(argv[i]), num))
+			{
+				std::cerr << "Error" << std::endl;
+				return false;
+			}
+			vectorData.push_back(num);
 		}
+		dequeData.assign(vectorData.begin(), vectorData.end());
 		
-		int num = atoi(arg.c_str());
-		_vectorData.push_back(num);
-		_dequeData.push_back(num);
+		return true;
 	}
-	
-	return true;
-}
 
-// Insertion sort for small arrays (vector version)
-void PmergeMe::insertionSortVector(std::vector<int>& arr, int left, int right)
-{
-	for (int i = left + 1; i <= right; ++i)
+	// Count tokens first so the vector is sized once, then parse in one pass
+	template <typename T>
+	bool parseTokens(const char* data, size_t size, std::vector<T>& vectorData, std::deque<T>& dequeData)
 	{
-		int key = arr[i];
-		int j = i - 1;
+		const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+		const unsigned char* end = p + size;
+		size_t count = 0;
+		unsigned int prevSeparator = 1;
 		
-		while (j >= left && arr[j] > key)
+		for (const unsigned char* q = p; q < end; ++q)
 		{
-			arr[j + 1] = arr[j];
-			--j;
+			unsigned int separator = (g_classes.table[*q] == SEPARATOR);
+			count += prevSeparator & !separator;
+			prevSeparator = separator;
+		}
+		if (count == 0)
+		{
+			std::cerr << "Error: no input provided" << std::endl;
+			return false;
 		}
-		arr[j + 1] = key;
-	}
-}
-
-// Ford-Johnson merge-insert sort for vector
-void PmergeMe::mergeInsertSortVector(std::vector<int>& arr)
-{
-	int n = arr.size();
-	
-	// Base case: use insertion sort for small arrays
-	if (n <= 10)
-	{
-		insertionSortVector(arr, 0, n - 1);
-		return;
-	}
-	
-	// Create pairs and sort them
-	std::vector<std::pair<int, int> > pairs;
-	int i;
-	
-	for (i = 0; i + 1 < n; i += 2)
-	{
-		if (arr[i] > arr[i + 1])
-			pairs.push_back(std::make_pair(arr[i + 1], arr[i]));
-		else
-			pairs.push_back(std::make_pair(arr[i], arr[i + 1]));
-	}
-	
-	// Handle odd element
-	int straggler = -1;
-	if (i < n)
-		straggler = arr[i];
-	
-	// Sort pairs by their larger element
-	for (size_t j = 1; j < pairs.size(); ++j)
-	{
-		std::pair<int, int> key = pairs[j];
-		int k = j - 1;
 		
-		while (k >= 0 && pairs[k].second > key.second)
+		vectorData.reserve(vectorData.size() + count);
+		while (p < end)
 		{
-			pairs[k + 1] = pairs[k];
-			--k;
+			while (p < end && g_classes.table[*p] == SEPARATOR)
+				++p;
+			if (p == end)
+				break;
+			
+			const unsigned char* start = p;
+			while (p < end && g_classes.table[*p] != SEPARATOR)
+				++p;
+			
+			T num;
+			if (!parseNumber(start, p, num))
+			{
+				std::cerr << "Error" << std::endl;
+				return false;
+			}
+			vectorData.push_back(num);
 		}
-		pairs[k + 1] = key;
+		dequeData.assign(vectorData.begin(), vectorData.end());
+		
+		return true;
 	}
-	
-	// Build main chain (larger elements) and pend (smaller elements)
-	std::vector<int> mainChain;
-	std::vector<int> pend;
-	
-	for (size_t j = 0; j < pairs.size(); ++j)
+
+	// PackedSort takes plain int keys only; main refuses --packed otherwise
+	void sortPacked(std::vector<int>& data, ScratchArena& arena, const MergeInsertConfig& config)
 	{
-		mainChain.push_back(pairs[j].second);
-		pend.push_back(pairs[j].first);
+		PackedSort::sort(&data[0], data.size(), arena, config);
 	}
-	
-	// Insert first pend element at the beginning (it's always smaller than first mainChain element)
-	if (!pend.empty())
-		mainChain.insert(mainChain.begin(), pend[0]);
-	
-	// Generate optimal Jacobsthal-based insertion order for remaining pend elements
-	std::vector<size_t> insertionOrder;
-	if (pend.size() > 1)
-		generateJacobsthalInsertionOrder(pend.size() - 1, insertionOrder);
-	
-	// Insert remaining pend elements in optimal order using binary search
-	for (size_t j = 0; j < insertionOrder.size(); ++j)
+
+	void sortPacked(std::deque<int>& data, ScratchArena& arena, const MergeInsertConfig& config)
 	{
-		size_t pendIndex = insertionOrder[j] + 1; // +1 because we already inserted pend[0]
-		std::vector<int>::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), pend[pendIndex]);
-		mainChain.insert(pos, pend[pendIndex]);
+		PackedSort::sort(data, arena, config);
 	}
-	
-	// Insert straggler if exists
-	if (straggler != -1)
+
+	template <typename T>
+	void sortPacked(std::vector<T>& data, ScratchArena&, const MergeInsertConfig& config)
 	{
-		std::vector<int>::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), straggler);
-		mainChain.insert(pos, straggler);
+		mergeInsertSort<VectorStorage>(data, config);
+	}
+
+	template <typename T>
+	void sortPacked(std::deque<T>& data, ScratchArena&, const MergeInsertConfig& config)
+	{
+		mergeInsertSort<DequeStorage>(data, config);
 	}
-	
-	arr = mainChain;
 }
 
-// Insertion sort for deque
-void PmergeMe::insertionSortDeque(std::deque<int>& arr, int left, int right)
+bool PmergeMe::parseInput(int argc, char** argv)
 {
-	for (int i = left + 1; i <= right; ++i)
+	if (argc < 2)
 	{
-		int key = arr[i];
-		int j = i - 1;
-		
-		while (j >= left && arr[j] > key)
-		{
-			arr[j + 1] = arr[j];
-			--j;
-		}
-		arr[j + 1] = key;
+		std::cerr << "Error: no input provided" << std::endl;
+		return false;
 	}
+	
+	if (_records && _keyType == KEY_INT64)
+		return parseArgs(argc, argv, _int64Records.vector, _int64Records.deque);
+	if (_records && _keyType == KEY_UINT64)
+		return parseArgs(argc, argv, _uint64Records.vector, _uint64Records.deque);
+	if (_records)
+		return parseArgs(argc, argv, _intRecords.vector, _intRecords.deque);
+	if (_keyType == KEY_INT64)
+		return parseArgs(argc, argv, _int64.vector, _int64.deque);
+	if (_keyType == KEY_UINT64)
+		return parseArgs(argc, argv, _uint64.vector, _uint64.deque);
+	return parseArgs(argc, argv, _vectorData, _dequeData);
 }
 
-// Ford-Johnson merge-insert sort for deque
-void PmergeMe::mergeInsertSortDeque(std::deque<int>& arr)
+// Whitespace-separated numbers from a file, or "-" for stdin.
+// Regular files are mapped; pipes and terminals are read whole.
+bool PmergeMe::parseFile(const std::string& path)
 {
-	int n = arr.size();
-	
-	// Base case: use insertion sort for small arrays
-	if (n <= 10)
+	int fd = (path == "-") ? 0 : open(path.c_str(), O_RDONLY);
+	if (fd < 0)
 	{
-		insertionSortDeque(arr, 0, n - 1);
-		return;
+		std::cerr << "Error: could not open file." << std::endl;
+		return false;
 	}
 	
-	// Create pairs and sort them
-	std::vector<std::pair<int, int> > pairs;
-	int i;
+	bool ok;
+	struct stat st;
+	void* map = MAP_FAILED;
+	
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 	
-	for (i = 0; i + 1 < n; i += 2)
+	if (map != MAP_FAILED)
 	{
-		if (arr[i] > arr[i + 1])
-			pairs.push_back(std::make_pair(arr[i + 1], arr[i]));
-		else
-			pairs.push_back(std::make_pair(arr[i], arr[i + 1]));
+		madvise(map, st.st_size, MADV_SEQUENTIAL);
+		ok = parseBuffer(static_cast<const char*>(map), st.st_size);
+		munmap(map, st.st_size);
 	}
-	
-	// Handle odd element
-	int straggler = -1;
-	if (i < n)
-		straggler = arr[i];
-	
-	// Sort pairs by their larger element
-	for (size_t j = 1; j < pairs.size(); ++j)
+	else
 	{
-		std::pair<int, int> key = pairs[j];
-		int k = j - 1;
+		std::vector<char> buffer(1 << 16);
+		size_t used = 0;
+		ssize_t r;
 		
-		while (k >= 0 && pairs[k].second > key.second)
+		while ((r = read(fd, &buffer[used], buffer.size() - used)) > 0)
 		{
-			pairs[k + 1] = pairs[k];
-			--k;
+			used += r;
+			if (used == buffer.size())
+				buffer.resize(buffer.size() * 2);
 		}
-		pairs[k + 1] = key;
-	}
-	
-	// Build main chain and pend
-	std::deque<int> mainChain;
-	std::deque<int> pend;
-	
-	for (size_t j = 0; j < pairs.size(); ++j)
-	{
-		mainChain.push_back(pairs[j].second);
-		pend.push_back(pairs[j].first);
-	}
-	
-	// Insert first pend element at the beginning
-	if (!pend.empty())
-		mainChain.push_front(pend[0]);
-	
-	// Generate optimal Jacobsthal-based insertion order for remaining pend elements
-	std::vector<size_t> insertionOrder;
-	if (pend.size() > 1)
-		generateJacobsthalInsertionOrder(pend.size() - 1, insertionOrder);
-	
-	// Insert remaining pend elements in optimal order using binary search
-	for (size_t j = 0; j < insertionOrder.size(); ++j)
-	{
-		size_t pendIndex = insertionOrder[j] + 1; // +1 because we already inserted pend[0]
-		std::deque<int>::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), pend[pendIndex]);
-		mainChain.insert(pos, pend[pendIndex]);
-	}
-	
-	// Insert straggler if exists
-	if (straggler != -1)
-	{
-		std::deque<int>::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), straggler);
-		mainChain.insert(pos, straggler);
+		if (r < 0)
+		{
+			std::cerr << "Error: could not read input." << std::endl;
+			ok = false;
+		}
+		else
+			ok = parseBuffer(&buffer[0], used);
 	}
 	
-	arr = mainChain;
+	if (fd != 0)
+		close(fd);
+	return ok;
+}
+
+bool PmergeMe::parseBuffer(const char* data, size_t size)
+{
+	if (_records && _keyType == KEY_INT64)
+		return parseTokens(data, size, _int64Records.vector, _int64Records.deque);
+	if (_records && _keyType == KEY_UINT64)
+		return parseTokens(data, size, _uint64Records.vector, _uint64Records.deque);
+	if (_records)
+		return parseTokens(data, size, _intRecords.vector, _intRecords.deque);
+	if (_keyType == KEY_INT64)
+		return parseTokens(data, size, _int64.vector, _int64.deque);
+	if (_keyType == KEY_UINT64)
+		return parseTokens(data, size, _uint64.vector, _uint64.deque);
+	return parseTokens(data, size, _vectorData, _dequeData);
 }
 
 void PmergeMe::sort()
+{
+	if (_records && _keyType == KEY_INT64)
+		sortKeys(_int64Records.vector, _int64Records.deque, _int64Records.spare);
+	else if (_records && _keyType == KEY_UINT64)
+		sortKeys(_uint64Records.vector, _uint64Records.deque, _uint64Records.spare);
+	else if (_records)
+		sortKeys(_intRecords.vector, _intRecords.deque, _intRecords.spare);
+	else if (_keyType == KEY_INT64)
+		sortKeys(_int64.vector, _int64.deque, _int64.spare);
+	else if (_keyType == KEY_UINT64)
+		sortKeys(_uint64.vector, _uint64.deque, _uint64.spare);
+	else
+		sortKeys(_vectorData, _dequeData, _spare);
+}
+
+// Every element type runs the same timed sorts
+template <typename T>
+void PmergeMe::sortKeys(std::vector<T>& vectorData, std::deque<T>& dequeData, std::vector<T>& spare)
 {
 	struct timeval start, end;
 	
+	// Keep the unsorted input for the blocked-chain comparison run
+	std::vector<T> blockedData;
+	if (_blockedChain)
+		blockedData = vectorData;
+	std::vector<T> parallelData;
+	if (_parallelThreads > 0)
+		parallelData = vectorData;
+	
+	// Instrumentation is opt-in: NULL stats skip all counting
+	SortStats stats[4];
+	SortStats* vectorStats = _collectStats ? &stats[0] : NULL;
+	SortStats* dequeStats = _collectStats ? &stats[1] : NULL;
+	SortStats* blockedStats = _collectStats ? &stats[2] : NULL;
+	SortStats* parallelStats = _collectStats ? &stats[3] : NULL;
+	
+	MergeInsertConfig vectorConfig;
+	vectorConfig.stats = vectorStats;
+	vectorConfig.jacobsthal = &_jacobsthal;
+	vectorConfig.leafSize = _minimalLeaf ? 0 : LeafSort::MAX_SIZE;
+	vectorConfig.adaptive = _adaptive;
+	MergeInsertConfig dequeConfig = vectorConfig;
+	dequeConfig.stats = dequeStats;
+	MergeInsertConfig blockedConfig = vectorConfig;
+	blockedConfig.blockedChain = true;
+	blockedConfig.stats = blockedStats;
+	ThreadPool pool;
+	MergeInsertConfig parallelConfig = vectorConfig;
+	parallelConfig.stats = parallelStats;
+	parallelConfig.pool = &pool;
+	parallelConfig.parallelThreshold = _parallelThreshold;
+	
+	// Setup happens once, outside the timed sorts: the insertion orders are
+	// shared by every path and every later call, and threads start up front
+	_jacobsthal.reserve(vectorData.size() / 2 + 1);
+	if (_parallelThreads > 0)
+		pool.start(_parallelThreads);
+	if (_useArena)
+	{
+		_arena.reserve(vectorData.size(), sizeof(T));
+		spare.reserve(vectorData.size());
+		vectorConfig.arena = &_arena;
+		blockedConfig.arena = &_arena;
+	}
+	if (_packed)
+		_arena.reserve(vectorData.size(), sizeof(PackedSort::Word));
+	
 	// Display before
 	std::cout << "Before: ";
-	for (size_t i = 0; i < _vectorData.size() && i < 5; ++i)
-		std::cout << _vectorData[i] << " ";
-	if (_vectorData.size() > 5)
+	for (size_t i = 0; i < vectorData.size() && i < 5; ++i)
+		std::cout << vectorData[i] << " ";
+	if (vectorData.size() > 5)
 		std::cout << "[...]";
 	std::cout << std::endl;
 	
 	// Sort with vector
 	gettimeofday(&start, NULL);
-	mergeInsertSortVector(_vectorData);
+	if (vectorStats)
+		SortStats::beginAllocationCount();
+	if (_packed)
+		sortPacked(vectorData, _arena, vectorConfig);
+	else if (_useArena)
+		mergeInsertSort(vectorData, spare, std::less<T>(), vectorConfig);
+	else
+		mergeInsertSort<VectorStorage>(vectorData, vectorConfig);
 	gettimeofday(&end, NULL);
 	
 	double vectorTime = (end.tv_sec - start.tv_sec) * 1000000.0;
 	vectorTime += (end.tv_usec - start.tv_usec);
+	if (vectorStats)
+		vectorStats->allocations = SortStats::endAllocationCount();
 	
 	// Display after
 	std::cout << "After:  ";
-	for (size_t i = 0; i < _vectorData.size() && i < 5; ++i)
-		std::cout << _vectorData[i] << " ";
-	if (_vectorData.size() > 5)
+	for (size_t i = 0; i < vectorData.size() && i < 5; ++i)
+		std::cout << vectorData[i] << " ";
+	if (vectorData.size() > 5)
 		std::cout << "[...]";
 	std::cout << std::endl;
 	
 	// Sort with deque
 	gettimeofday(&start, NULL);
-	mergeInsertSortDeque(_dequeData);
+	if (dequeStats)
+		SortStats::beginAllocationCount();
+	if (_packed)
+		sortPacked(dequeData, _arena, dequeConfig);
+	else
+		mergeInsertSort<DequeStorage>(dequeData, dequeConfig);
 	gettimeofday(&end, NULL);
 	
 	double dequeTime = (end.tv_sec - start.tv_sec) * 1000000.0;
 	dequeTime += (end.tv_usec - start.tv_usec);
+	if (dequeStats)
+		dequeStats->allocations = SortStats::endAllocationCount();
 	
 	// Display times
 	std::cout << std::fixed << std::setprecision(5);
-	std::cout << "Time to process a range of " << _vectorData.size() 
-			  << " elements with std::vector : " << vectorTime << " us" << std::endl;
-	std::cout << "Time to process a range of " << _dequeData.size() 
-			  << " elements with std::deque : " << dequeTime << " us" << std::endl;
+	std::string vectorLabel = _packed ? "std::vector (packed)" : _useArena ? "std::vector (scratch arena)" : "std::vector";
+	std::string dequeLabel = _packed ? "std::deque (packed)" : "std::deque";
+	std::cout << "Time to process a range of " << vectorData.size() 
+			  << " elements with " << vectorLabel << " : " << vectorTime << " us" << std::endl;
+	std::cout << "Time to process a range of " << dequeData.size() 
+			  << " elements with " << dequeLabel << " : " << dequeTime << " us" << std::endl;
+	
+	// Same vector sort, with the insertion phase on a BlockedChain
+	if (_blockedChain)
+	{
+		if (blockedStats)
+			SortStats::beginAllocationCount();
+		gettimeofday(&start, NULL);
+		if (_useArena)
+			mergeInsertSort(blockedData, spare, std::less<T>(), blockedConfig);
+		else
+			mergeInsertSort<VectorStorage>(blockedData, blockedConfig);
+		gettimeofday(&end, NULL);
+		
+		double blockedTime = (end.tv_sec - start.tv_sec) * 1000000.0;
+		blockedTime += (end.tv_usec - start.tv_usec);
+		if (blockedStats)
+			blockedStats->allocations = SortStats::endAllocationCount();
+		std::cout << "Time to process a range of " << blockedData.size()
+				  << " elements with std::vector (blocked chain) : " << blockedTime << " us" << std::endl;
+	}
+	
+	// Same vector sort with large levels spread over the pool
+	std::ostringstream parallelLabel;
+	parallelLabel << "std::vector (parallel, " << pool.threads() << " threads)";
+	if (_parallelThreads > 0)
+	{
+		if (parallelStats)
+			SortStats::beginAllocationCount();
+		gettimeofday(&start, NULL);
+		mergeInsertSort<VectorStorage>(parallelData, parallelConfig);
+		gettimeofday(&end, NULL);
+		
+		double parallelTime = (end.tv_sec - start.tv_sec) * 1000000.0;
+		parallelTime += (end.tv_usec - start.tv_usec);
+		if (parallelStats)
+			parallelStats->allocations = SortStats::endAllocationCount();
+		std::cout << "Time to process a range of " << parallelData.size()
+				  << " elements with " << parallelLabel.str() << " : " << parallelTime << " us" << std::endl;
+		for (size_t t = 0; t < pool.threads(); ++t)
+			std::cout << "    thread " << t << " : " << pool.busyTime(t) << " us busy, "
+					  << pool.chunks(t) << " chunks" << std::endl;
+	}
+	
+	if (_collectStats)
+	{
+		static const char* const typeNames[] = { "int", "int64", "uint64" };
+		std::cout << "Keys : " << typeNames[_keyType] << (_records ? " records" : "") << std::endl;
+		if (_minimalLeaf)
+			std::cout << "Leaf sort : none, Ford-Johnson down to single keys" << std::endl;
+		else
+			std::cout << "Leaf sort : " << LeafSort::kind() << " rank sort, levels of up to "
+					  << LeafSort::MAX_SIZE << " keys" << std::endl;
+		if (_packed)
+			std::cout << "Packed pairing : " << PackedSort::kind() << std::endl;
+		vectorStats->print(std::cout, vectorLabel, vectorData.size());
+		dequeStats->print(std::cout, dequeLabel, dequeData.size());
+		if (_blockedChain)
+			blockedStats->print(std::cout, "std::vector (blocked chain)", blockedData.size());
+		if (_parallelThreads > 0)
+			parallelStats->print(std::cout, parallelLabel.str(), parallelData.size());
+	}
+}
+
+void PmergeMe::setBlockedChain(bool enabled)
+{
+	_blockedChain = enabled;
+}
+
+void PmergeMe::setCollectStats(bool enabled)
+{
+	_collectStats = enabled;
+}
+
+void PmergeMe::setUseArena(bool enabled)
+{
+	_useArena = enabled;
+}
+
+void PmergeMe::setMinimalLeaf(bool enabled)
+{
+	_minimalLeaf = enabled;
+}
+
+void PmergeMe::setAdaptive(bool enabled)
+{
+	_adaptive = enabled;
+}
+
+void PmergeMe::setPacked(bool enabled)
+{
+	_packed = enabled;
+}
+
+void PmergeMe::setKeyType(KeyType type)
+{
+	_keyType = type;
+}
+
+void PmergeMe::setRecords(bool enabled)
+{
+	_records = enabled;
+}
+
+void PmergeMe::setParallel(size_t threads)
+{
+	_parallelThreads = threads;
+}
+
+void PmergeMe::setParallelThreshold(size_t threshold)
+{
+	_parallelThreshold = threshold;
 }
 
 void PmergeMe::displayResults() const
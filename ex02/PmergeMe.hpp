@@ -4,27 +4,80 @@
 #include <vector>
 #include <deque>
 #include <string>
+#include <ostream>
+
+#include "ScratchArena.hpp"
+#include "JacobsthalOrder.hpp"
+
+// Key with a payload carried along, ordered by key alone
+template <typename K>
+struct Record
+{
+	K key;
+	unsigned long long payload;
+};
+
+template <typename K>
+bool operator<(const Record<K>& a, const Record<K>& b)
+{
+	return a.key < b.key;
+}
+
+template <typename K>
+std::ostream& operator<<(std::ostream& os, const Record<K>& record)
+{
+	return os << record.key << ':' << record.payload;
+}
+
+// Input of one element type: both containers, and the spare buffer the
+// arena sort swaps with
+template <typename T>
+struct KeyData
+{
+	std::vector<T> vector;
+	std::deque<T> deque;
+	std::vector<T> spare;
+};
 
 class PmergeMe
 {
+public:
+	// Key width, picked before parsing; int keeps its own containers
+	enum KeyType
+	{
+		KEY_INT,
+		KEY_INT64,
+		KEY_UINT64
+	};
+
 private:
 	std::vector<int> _vectorData;
 	std::deque<int> _dequeData;
+	KeyData<long long> _int64;
+	KeyData<unsigned long long> _uint64;
+	KeyData<Record<int> > _intRecords;
+	KeyData<Record<long long> > _int64Records;
+	KeyData<Record<unsigned long long> > _uint64Records;
+	KeyType _keyType;
+	bool _records;
+	bool _blockedChain;
+	bool _collectStats;
+	bool _useArena;
+	bool _minimalLeaf;
+	bool _adaptive;
+	bool _packed;
+	size_t _parallelThreads;
+	size_t _parallelThreshold;
+	ScratchArena _arena;
+	std::vector<int> _spare;
+	JacobsthalOrder _jacobsthal;
 	
-	// Helper functions for vector
-	void mergeInsertSortVector(std::vector<int>& arr);
-	void insertionSortVector(std::vector<int>& arr, int left, int right);
-	
-	// Helper functions for deque
-	void mergeInsertSortDeque(std::deque<int>& arr);
-	void insertionSortDeque(std::deque<int>& arr, int left, int right);
-	
-	// Validation
-	bool isValidNumber(const std::string& str) const;
+	// Parsing
+	bool parseBuffer(const char* data, size_t size);
 	
-	// Jacobsthal number generation for optimal insertion order
-	size_t jacobsthal(size_t n) const;
-	void generateJacobsthalInsertionOrder(size_t pendSize, std::vector<size_t>& order) const;
+	// One sort of whichever element type was parsed
+	template <typename T>
+	void sortKeys(std::vector<T>& vectorData, std::deque<T>& dequeData, std::vector<T>& spare);
 
 public:
 	// Orthodox Canonical Form
@@ -35,9 +88,40 @@ public:
 
 	// Methods
 	bool parseInput(int argc, char** argv);
+	bool parseFile(const std::string& path);
 	void sort();
 	void displayResults() const;
 	
+	// Also time the vector sort with a BlockedChain insertion phase
+	void setBlockedChain(bool enabled);
+	
+	// Report comparisons, moves, allocations and phase times after sort()
+	void setCollectStats(bool enabled);
+	
+	// Sort the vector inside a scratch arena sized once from n
+	void setUseArena(bool enabled);
+	
+	// Keep Ford-Johnson down to single keys instead of the rank-sorted leaf,
+	// for the fewest comparisons rather than the best time
+	void setMinimalLeaf(bool enabled);
+	
+	// Check for sorted, reversed or run-structured input before sorting and
+	// take a cheaper path when there is one
+	void setAdaptive(bool enabled);
+	
+	// Sort both containers through PackedSort's 64-bit word layout (int
+	// keys only)
+	void setPacked(bool enabled);
+	
+	// Parse and sort 64-bit keys, or key:payload records, instead of int
+	void setKeyType(KeyType type);
+	void setRecords(bool enabled);
+	
+	// Also time the vector sort on this many threads (0 disables); levels
+	// below the threshold run sequentially
+	void setParallel(size_t threads);
+	void setParallelThreshold(size_t threshold);
+	
 	const std::vector<int>& getVectorData() const;
 	const std::deque<int>& getDequeData() const;
 };
@@ -0,0 +1,83 @@
+#include "ScratchArena.hpp"
+#include <stdexcept>
+
+// Every allocation is rounded up so any key type stays aligned
+static size_t slot(size_t bytes)
+{
+	return (bytes + 15) / 16 * 16;
+}
+
+// Orthodox Canonical Form
+ScratchArena::ScratchArena() : _top(0) {}
+
+ScratchArena::ScratchArena(const ScratchArena& other)
+	: _buffer(other._buffer), _top(0), _chain(other._chain) {}
+
+ScratchArena& ScratchArena::operator=(const ScratchArena& other)
+{
+	if (this != &other)
+	{
+		_buffer = other._buffer;
+		_top = 0;
+		_chain = other._chain;
+	}
+	return *this;
+}
+
+ScratchArena::~ScratchArena() {}
+
+// Setup: size the buffer and the shared blocked chain for n keys of keySize bytes
+void ScratchArena::reserve(size_t n, size_t keySize)
+{
+	size_t bytes = requiredBytes(n, keySize);
+	
+	if (_buffer.size() < bytes)
+		_buffer.resize(bytes);
+	_chain.reset(n);
+	_top = 0;
+}
+
+void* ScratchArena::allocate(size_t bytes)
+{
+	bytes = slot(bytes);
+	if (bytes == 0)
+		return NULL;
+	if (_top + bytes > _buffer.size())
+		throw std::length_error("ScratchArena: not reserved for this size");
+	
+	void* p = &_buffer[0] + _top;
+	_top += bytes;
+	return p;
+}
+
+size_t ScratchArena::mark() const
+{
+	return _top;
+}
+
+void ScratchArena::release(size_t mark)
+{
+	_top = mark;
+}
+
+BlockedChain<size_t>& ScratchArena::chain()
+{
+	return _chain;
+}
+
+// Peak usage of a merge-insert sort of n keys: the top-level order and
+// result, then per level the larger keys and five position arrays (pair
+// members, pair order, partners and pend), all alive down the recursion
+size_t ScratchArena::requiredBytes(size_t n, size_t keySize)
+{
+	size_t bytes = slot(n * sizeof(size_t)) + slot(n * keySize);
+	
+	for (size_t m = n; m > 1; m /= 2)
+	{
+		size_t p = m / 2;
+		bytes += slot(p * keySize);
+		bytes += 4 * slot(p * sizeof(size_t));
+		bytes += slot((p + 1) * sizeof(size_t));
+	}
+	return bytes;
+}
@@ -0,0 +1,70 @@
+#ifndef SCRATCHARENA_HPP
+#define SCRATCHARENA_HPP
+
+#include <vector>
+#include <cstddef>
+
+#include "BlockedChain.hpp"
+
+// One preallocated byte buffer handed out as a stack: every level of the
+// merge-insert recursion takes its working arrays from the top and gives
+// them back when it returns. Sized once with reserve(), a sort of up to that
+// many elements then runs without touching the heap.
+class ScratchArena
+{
+private:
+	std::vector<char> _buffer;
+	size_t _top;
+	BlockedChain<size_t> _chain;
+
+public:
+	// Orthodox Canonical Form
+	ScratchArena();
+	ScratchArena(const ScratchArena& other);
+	ScratchArena& operator=(const ScratchArena& other);
+	~ScratchArena();
+
+	// Methods
+	void reserve(size_t n, size_t keySize);
+	void* allocate(size_t bytes);
+	size_t mark() const;
+	void release(size_t mark);
+	BlockedChain<size_t>& chain();
+
+	static size_t requiredBytes(size_t n, size_t keySize);
+};
+
+// Fixed-capacity sequence of trivially copyable T living in a ScratchArena.
+// Arena memory is released in reverse order of attach(), which is the order
+// locals are destroyed in, so sequences are not copyable.
+template <typename T>
+class ArenaSeq
+{
+private:
+	ScratchArena* _arena;
+	T* _data;
+	size_t _size;
+	size_t _capacity;
+	size_t _mark;
+
+	ArenaSeq(const ArenaSeq& other);
+	ArenaSeq& operator=(const ArenaSeq& other);
+
+public:
+	ArenaSeq();
+	~ArenaSeq();
+
+	void attach(ScratchArena& arena, size_t size, size_t capacity);
+	size_t size() const;
+	T* data();
+	const T* data() const;
+	T& operator[](size_t i);
+	const T& operator[](size_t i) const;
+	void clear();
+	void push_back(const T& value);
+	void insert(size_t rank, const T& value);
+};
+
+#include "ScratchArena.tpp"
+
+#endif
@@ -0,0 +1,71 @@
+#include <algorithm>
+
+template <typename T>
+ArenaSeq<T>::ArenaSeq() : _arena(NULL), _data(NULL), _size(0), _capacity(0), _mark(0) {}
+
+template <typename T>
+ArenaSeq<T>::~ArenaSeq()
+{
+	if (_arena)
+		_arena->release(_mark);
+}
+
+template <typename T>
+void ArenaSeq<T>::attach(ScratchArena& arena, size_t size, size_t capacity)
+{
+	_arena = &arena;
+	_mark = arena.mark();
+	_data = static_cast<T*>(arena.allocate(capacity * sizeof(T)));
+	_size = size;
+	_capacity = capacity;
+}
+
+template <typename T>
+size_t ArenaSeq<T>::size() const
+{
+	return _size;
+}
+
+template <typename T>
+T* ArenaSeq<T>::data()
+{
+	return _data;
+}
+
+template <typename T>
+const T* ArenaSeq<T>::data() const
+{
+	return _data;
+}
+
+template <typename T>
+T& ArenaSeq<T>::operator[](size_t i)
+{
+	return _data[i];
+}
+
+template <typename T>
+const T& ArenaSeq<T>::operator[](size_t i) const
+{
+	return _data[i];
+}
+
+template <typename T>
+void ArenaSeq<T>::clear()
+{
+	_size = 0;
+}
+
+template <typename T>
+void ArenaSeq<T>::push_back(const T& value)
+{
+	_data[_size++] = value;
+}
+
+template <typename T>
+void ArenaSeq<T>::insert(size_t rank, const T& value)
+{
+	std::copy_backward(_data + rank, _data + _size, _data + _size + 1);
+	_data[rank] = value;
+	++_size;
+}
@@ -0,0 +1,143 @@
+#include "SortStats.hpp"
+#include <sys/time.h>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+
+// Every heap allocation in the program goes through here, but is only
+// counted while an instrumented sort runs. Pool workers allocate at the
+// same time as the caller, so the counter is updated atomically.
+static unsigned long g_allocations = 0;
+static int g_countingAllocations = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc)
+{
+	if (__atomic_load_n(&g_countingAllocations, __ATOMIC_RELAXED))
+		__sync_fetch_and_add(&g_allocations, 1);
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) throw()
+{
+	std::free(p);
+}
+
+// Orthodox Canonical Form
+SortStats::SortStats()
+{
+	reset();
+}
+
+SortStats::SortStats(const SortStats& other)
+	: comparisons(other.comparisons), moves(other.moves), allocations(other.allocations),
+	  pairingTime(other.pairingTime), recursionTime(other.recursionTime),
+	  jacobsthalTime(other.jacobsthalTime), insertionTime(other.insertionTime),
+	  presortTime(other.presortTime), runs(other.runs), path(other.path), depth(other.depth) {}
+
+SortStats& SortStats::operator=(const SortStats& other)
+{
+	if (this != &other)
+	{
+		comparisons = other.comparisons;
+		moves = other.moves;
+		allocations = other.allocations;
+		pairingTime = other.pairingTime;
+		recursionTime = other.recursionTime;
+		jacobsthalTime = other.jacobsthalTime;
+		insertionTime = other.insertionTime;
+		presortTime = other.presortTime;
+		runs = other.runs;
+		path = other.path;
+		depth = other.depth;
+	}
+	return *this;
+}
+
+SortStats::~SortStats() {}
+
+void SortStats::reset()
+{
+	comparisons = 0;
+	moves = 0;
+	allocations = 0;
+	pairingTime = 0;
+	recursionTime = 0;
+	jacobsthalTime = 0;
+	insertionTime = 0;
+	presortTime = 0;
+	runs = 0;
+	path = NULL;
+	depth = 0;
+}
+
+// Wall clock in microseconds
+double SortStats::now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+// Count allocations from every thread, starting from zero
+void SortStats::beginAllocationCount()
+{
+	__atomic_store_n(&g_allocations, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&g_countingAllocations, 1, __ATOMIC_SEQ_CST);
+}
+
+// Stop counting; returns the allocations since beginAllocationCount()
+unsigned long SortStats::endAllocationCount()
+{
+	__atomic_store_n(&g_countingAllocations, 0, __ATOMIC_SEQ_CST);
+	return __sync_fetch_and_add(&g_allocations, 0);
+}
+
+// Worst-case comparisons of Ford-Johnson: F(n) = sum of ceil(log2(3k/4)), k = 1..n
+unsigned long SortStats::fordJohnsonBound(size_t n)
+{
+	unsigned long total = 0;
+	unsigned long power = 1; // 2^t
+	unsigned long t = 0;
+	
+	for (size_t k = 1; k <= n; ++k)
+	{
+		// Smallest t with 2^t >= 3k/4
+		while (4 * power < 3 * k)
+		{
+			power *= 2;
+			++t;
+		}
+		total += t;
+	}
+	return total;
+}
+
+// Information-theoretic lower bound: ceil(log2(n!))
+unsigned long SortStats::informationBound(size_t n)
+{
+	double bits = 0;
+	
+	for (size_t k = 2; k <= n; ++k)
+		bits += std::log(static_cast<double>(k));
+	bits /= std::log(2.0);
+	return static_cast<unsigned long>(std::ceil(bits - 1e-9));
+}
+
+void SortStats::print(std::ostream& os, const std::string& label, size_t n) const
+{
+	unsigned long bound = fordJohnsonBound(n);
+	
+	os << "Stats for " << label << " : " << comparisons << " comparisons (F(n) = " << bound
+	   << ", log2(n!) = " << informationBound(n) << ", "
+	   << (comparisons <= bound ? "within bound" : "ABOVE BOUND") << "), "
+	   << moves << " moves, " << allocations << " allocations" << std::endl;
+	os << "Phases for " << label << " : pairing " << pairingTime << " us, recursion "
+	   << recursionTime << " us, jacobsthal " << jacobsthalTime << " us, insertion "
+	   << insertionTime << " us" << std::endl;
+	if (path)
+		os << "Presortedness for " << label << " : " << runs << " runs, " << path
+		   << " path, pre-pass " << presortTime << " us" << std::endl;
+}
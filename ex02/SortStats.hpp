@@ -0,0 +1,45 @@
+#ifndef SORTSTATS_HPP
+#define SORTSTATS_HPP
+
+#include <string>
+#include <ostream>
+#include <cstddef>
+
+// Counters filled in by an instrumented PmergeMe sort.
+// Phase times are taken at the outermost level: "recursion" is the nested
+// sort of the larger pair members, including all of its own phases, so the
+// four phases add up to the wall time of the sort. An adaptive sort also
+// records its presortedness pre-pass and the path it chose (NULL otherwise).
+class SortStats
+{
+public:
+	unsigned long comparisons;
+	unsigned long moves;
+	unsigned long allocations;
+	double pairingTime;
+	double recursionTime;
+	double jacobsthalTime;
+	double insertionTime;
+	double presortTime;
+	size_t runs;
+	const char* path;
+	size_t depth;
+
+	// Orthodox Canonical Form
+	SortStats();
+	SortStats(const SortStats& other);
+	SortStats& operator=(const SortStats& other);
+	~SortStats();
+
+	// Methods
+	void reset();
+	void print(std::ostream& os, const std::string& label, size_t n) const;
+
+	static double now();
+	static void beginAllocationCount();
+	static unsigned long endAllocationCount();
+	static unsigned long fordJohnsonBound(size_t n);
+	static unsigned long informationBound(size_t n);
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "ThreadPool.hpp"
+#include "SortStats.hpp"
+#include <unistd.h>
+
+ThreadPool::ThreadPool()
+	: _task(NULL), _next(0), _count(0), _grain(1), _pending(0), _generation(0), _stopping(false),
+	  _busy(1, 0), _chunks(1, 0)
+{
+	pthread_mutex_init(&_mutex, NULL);
+	pthread_cond_init(&_wake, NULL);
+	pthread_cond_init(&_done, NULL);
+}
+
+ThreadPool::~ThreadPool()
+{
+	stop();
+	pthread_cond_destroy(&_done);
+	pthread_cond_destroy(&_wake);
+	pthread_mutex_destroy(&_mutex);
+}
+
+// Setup: threads counts the caller, so start(1) runs everything inline.
+// If the system refuses a thread, the pool runs with the ones it has.
+void ThreadPool::start(size_t threads)
+{
+	stop();
+	if (threads == 0)
+		threads = 1;
+
+	_starts.resize(threads);
+	_threads.reserve(threads - 1);
+	for (size_t i = 1; i < threads; ++i)
+	{
+		pthread_t thread;
+
+		_starts[i].pool = this;
+		_starts[i].worker = i;
+		if (pthread_create(&thread, NULL, &ThreadPool::workerMain, &_starts[i]) != 0)
+			break;
+		_threads.push_back(thread);
+	}
+	_busy.assign(_threads.size() + 1, 0);
+	_chunks.assign(_threads.size() + 1, 0);
+}
+
+void ThreadPool::stop()
+{
+	pthread_mutex_lock(&_mutex);
+	_stopping = true;
+	pthread_cond_broadcast(&_wake);
+	pthread_mutex_unlock(&_mutex);
+
+	for (size_t i = 0; i < _threads.size(); ++i)
+		pthread_join(_threads[i], NULL);
+	_threads.clear();
+	_stopping = false;
+}
+
+size_t ThreadPool::threads() const
+{
+	return _threads.size() + 1;
+}
+
+// Run task over [0, count) and return once every chunk is done.
+// Ranges of a single chunk stay on the calling thread.
+void ThreadPool::parallelFor(size_t count, size_t grain, Task& task)
+{
+	if (grain == 0)
+		grain = 1;
+	if (_threads.empty() || count <= grain)
+	{
+		if (count == 0)
+			return;
+		double t = SortStats::now();
+		task.run(0, count, 0);
+		_busy[0] += SortStats::now() - t;
+		++_chunks[0];
+		return;
+	}
+
+	pthread_mutex_lock(&_mutex);
+	_task = &task;
+	_next = 0;
+	_count = count;
+	_grain = grain;
+	_pending = _threads.size();
+	++_generation;
+	pthread_cond_broadcast(&_wake);
+	pthread_mutex_unlock(&_mutex);
+
+	work(0);
+
+	pthread_mutex_lock(&_mutex);
+	while (_pending > 0)
+		pthread_cond_wait(&_done, &_mutex);
+	_task = NULL;
+	pthread_mutex_unlock(&_mutex);
+}
+
+// Claim chunks until the range is used up
+void ThreadPool::work(size_t worker)
+{
+	pthread_mutex_lock(&_mutex);
+	while (_next < _count)
+	{
+		size_t begin = _next;
+		size_t end = (_count - begin > _grain) ? begin + _grain : _count;
+		Task* task = _task;
+
+		_next = end;
+		pthread_mutex_unlock(&_mutex);
+
+		double t = SortStats::now();
+		task->run(begin, end, worker);
+		_busy[worker] += SortStats::now() - t;
+		++_chunks[worker];
+
+		pthread_mutex_lock(&_mutex);
+	}
+	pthread_mutex_unlock(&_mutex);
+}
+
+void* ThreadPool::workerMain(void* arg)
+{
+	Start* start = static_cast<Start*>(arg);
+	ThreadPool& pool = *start->pool;
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&pool._mutex);
+	while (true)
+	{
+		while (!pool._stopping && pool._generation == seen)
+			pthread_cond_wait(&pool._wake, &pool._mutex);
+		if (pool._stopping)
+			break;
+		seen = pool._generation;
+
+		pthread_mutex_unlock(&pool._mutex);
+		pool.work(start->worker);
+		pthread_mutex_lock(&pool._mutex);
+
+		if (--pool._pending == 0)
+			pthread_cond_signal(&pool._done);
+	}
+	pthread_mutex_unlock(&pool._mutex);
+	return NULL;
+}
+
+void ThreadPool::resetTimes()
+{
+	_busy.assign(_busy.size(), 0);
+	_chunks.assign(_chunks.size(), 0);
+}
+
+double ThreadPool::busyTime(size_t worker) const
+{
+	return _busy[worker];
+}
+
+size_t ThreadPool::chunks(size_t worker) const
+{
+	return _chunks[worker];
+}
+
+size_t ThreadPool::hardwareThreads()
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? static_cast<size_t>(n) : 1;
+}
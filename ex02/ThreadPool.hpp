@@ -0,0 +1,70 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <cstddef>
+#include <pthread.h>
+
+// Fixed set of worker threads for parallel loops over an index range.
+// The range is cut into grain-sized chunks that idle workers claim from a
+// shared cursor, so a thread that finishes early keeps taking work from the
+// ones still busy. The calling thread joins in as worker 0. Busy time and
+// chunk counts are kept per worker for reporting.
+class ThreadPool
+{
+public:
+	// Work for one chunk [begin, end) on the given worker
+	class Task
+	{
+	public:
+		virtual ~Task() {}
+		virtual void run(size_t begin, size_t end, size_t worker) = 0;
+	};
+
+private:
+	std::vector<pthread_t> _threads;
+	pthread_mutex_t _mutex;
+	pthread_cond_t _wake;
+	pthread_cond_t _done;
+	Task* _task;
+	size_t _next;
+	size_t _count;
+	size_t _grain;
+	size_t _pending;
+	unsigned long _generation;
+	bool _stopping;
+	std::vector<double> _busy;
+	std::vector<size_t> _chunks;
+
+	// Threads cannot be copied
+	ThreadPool(const ThreadPool& other);
+	ThreadPool& operator=(const ThreadPool& other);
+
+	struct Start
+	{
+		ThreadPool* pool;
+		size_t worker;
+	};
+	std::vector<Start> _starts;
+
+	static void* workerMain(void* arg);
+	void work(size_t worker);
+
+public:
+	ThreadPool();
+	~ThreadPool();
+
+	// Methods
+	void start(size_t threads);
+	void stop();
+	size_t threads() const;
+	void parallelFor(size_t count, size_t grain, Task& task);
+
+	void resetTimes();
+	double busyTime(size_t worker) const;
+	size_t chunks(size_t worker) const;
+
+	static size_t hardwareThreads();
+};
+
+#endif
@@ -1,11 +1,116 @@
 #include "PmergeMe.hpp"
+#include "ThreadPool.hpp"
 #include <iostream>
+#include <string>
+#include <cstdlib>
+
+// Option argument: a positive decimal count
+static bool parseCount(const char* str, size_t& out)
+{
+	char* end;
+	unsigned long value = std::strtoul(str, &end, 10);
+	
+	if (*str < '0' || *str > '9' || *end != '\0' || value == 0)
+		return false;
+	out = value;
+	return true;
+}
 
 int main(int argc, char** argv)
 {
 	PmergeMe sorter;
+	int first = 1;
+	std::string inputPath;
+	size_t count;
+	bool packed = false;
+	bool wide = false;
+	
+	// Leading "--" options; numbers follow
+	while (first < argc && std::string(argv[first]).compare(0, 2, "--") == 0)
+	{
+		std::string opt(argv[first]);
+		
+		if (opt == "--blocked")
+			sorter.setBlockedChain(true);
+		else if (opt == "--stats")
+			sorter.setCollectStats(true);
+		else if (opt == "--arena")
+			sorter.setUseArena(true);
+		else if (opt == "--minimal-leaf")
+			sorter.setMinimalLeaf(true);
+		else if (opt == "--adaptive")
+			sorter.setAdaptive(true);
+		else if (opt == "--packed")
+		{
+			sorter.setPacked(true);
+			packed = true;
+		}
+		else if (opt == "--records")
+		{
+			sorter.setRecords(true);
+			wide = true;
+		}
+		else if (opt == "--type" && first + 1 < argc)
+		{
+			std::string type(argv[++first]);
+			
+			if (type == "int64")
+				sorter.setKeyType(PmergeMe::KEY_INT64);
+			else if (type == "uint64")
+				sorter.setKeyType(PmergeMe::KEY_UINT64);
+			else if (type != "int")
+			{
+				std::cerr << "Error: --type is int, int64 or uint64" << std::endl;
+				return 1;
+			}
+			wide = wide || type != "int";
+		}
+		else if (opt == "--parallel")
+			sorter.setParallel(ThreadPool::hardwareThreads());
+		else if (opt == "--threads" || opt == "--threshold")
+		{
+			if (first + 1 >= argc || !parseCount(argv[first + 1], count))
+			{
+				std::cerr << "Error: " << opt << " needs a positive count" << std::endl;
+				return 1;
+			}
+			if (opt == "--threads")
+				sorter.setParallel(count);
+			else
+				sorter.setParallelThreshold(count);
+			++first;
+		}
+		else if (opt == "--stdin")
+			inputPath = "-";
+		else if (opt == "--file" && first + 1 < argc)
+			inputPath = argv[++first];
+		else
+		{
+			std::cerr << "Error: unknown option " << opt << std::endl;
+			return 1;
+		}
+		++first;
+	}
+	
+	if (packed && wide)
+	{
+		std::cerr << "Error: --packed needs plain int keys" << std::endl;
+		return 1;
+	}
 	
-	if (!sorter.parseInput(argc, argv))
+	// Numbers come from the file or stdin, or else from the remaining args
+	if (!inputPath.empty())
+	{
+		if (first < argc)
+		{
+			std::cerr << "Error" << std::endl;
+			return 1;
+		}
+		if (!sorter.parseFile(inputPath))
+			return 1;
+	}
+	// argv[first - 1] stands in for the program name
+	else if (!sorter.parseInput(argc - first + 1, argv + first - 1))
 		return 1;
 	
 	sorter.sort();
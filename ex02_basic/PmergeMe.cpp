@@ -70,8 +70,9 @@ bool PmergeMe::parseInput(int argc, char** argv)
 	return true;
 }
 
-// Insertion sort for small arrays (vector version)
-void PmergeMe::insertionSortVector(std::vector<int>& arr, int left, int right)
+// Insertion sort for small arrays (vector and deque)
+template <typename Container>
+void PmergeMe::insertionSort(Container& arr, int left, int right)
 {
 	for (int i = left + 1; i <= right; ++i)
 	{
@@ -87,15 +88,16 @@ void PmergeMe::insertionSortVector(std::vector<int>& arr, int left, int right)
 	}
 }
 
-// Ford-Johnson merge-insert sort for vector
-void PmergeMe::mergeInsertSortVector(std::vector<int>& arr)
+// Ford-Johnson merge-insert sort (vector and deque)
+template <typename Container>
+void PmergeMe::mergeInsertSort(Container& arr)
 {
 	int n = arr.size();
 	
 	// Base case: use insertion sort for small arrays
 	if (n <= 10)
 	{
-		insertionSortVector(arr, 0, n - 1);
+		insertionSort(arr, 0, n - 1);
 		return;
 	}
 	
@@ -131,8 +133,8 @@ void PmergeMe::mergeInsertSortVector(std::vector<int>& arr)
 	}
 	
 	// Build main chain (larger elements) and pend (smaller elements)
-	std::vector<int> mainChain;
-	std::vector<int> pend;
+	Container mainChain;
+	Container pend;
 	
 	for (size_t j = 0; j < pairs.size(); ++j)
 	{
@@ -147,105 +149,14 @@ void PmergeMe::mergeInsertSortVector(std::vector<int>& arr)
 	// Insert remaining pend elements using binary search
 	for (size_t j = 1; j < pend.size(); ++j)
 	{
-		std::vector<int>::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), pend[j]);
+		typename Container::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), pend[j]);
 		mainChain.insert(pos, pend[j]);
 	}
 	
 	// Insert straggler if exists
 	if (straggler != -1)
 	{
-		std::vector<int>::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), straggler);
-		mainChain.insert(pos, straggler);
-	}
-	
-	arr = mainChain;
-}
-
-// Insertion sort for deque
-void PmergeMe::insertionSortDeque(std::deque<int>& arr, int left, int right)
-{
-	for (int i = left + 1; i <= right; ++i)
-	{
-		int key = arr[i];
-		int j = i - 1;
-		
-		while (j >= left && arr[j] > key)
-		{
-			arr[j + 1] = arr[j];
-			--j;
-		}
-		arr[j + 1] = key;
-	}
-}
-
-// Ford-Johnson merge-insert sort for deque
-void PmergeMe::mergeInsertSortDeque(std::deque<int>& arr)
-{
-	int n = arr.size();
-	
-	// Base case: use insertion sort for small arrays
-	if (n <= 10)
-	{
-		insertionSortDeque(arr, 0, n - 1);
-		return;
-	}
-	
-	// Create pairs and sort them
-	std::vector<std::pair<int, int> > pairs;
-	int i;
-	
-	for (i = 0; i + 1 < n; i += 2)
-	{
-		if (arr[i] > arr[i + 1])
-			pairs.push_back(std::make_pair(arr[i + 1], arr[i]));
-		else
-			pairs.push_back(std::make_pair(arr[i], arr[i + 1]));
-	}
-	
-	// Handle odd element
-	int straggler = -1;
-	if (i < n)
-		straggler = arr[i];
-	
-	// Sort pairs by their larger element
-	for (size_t j = 1; j < pairs.size(); ++j)
-	{
-		std::pair<int, int> key = pairs[j];
-		int k = j - 1;
-		
-		while (k >= 0 && pairs[k].second > key.second)
-		{
-			pairs[k + 1] = pairs[k];
-			--k;
-		}
-		pairs[k + 1] = key;
-	}
-	
-	// Build main chain and pend
-	std::deque<int> mainChain;
-	std::deque<int> pend;
-	
-	for (size_t j = 0; j < pairs.size(); ++j)
-	{
-		mainChain.push_back(pairs[j].second);
-		pend.push_back(pairs[j].first);
-	}
-	
-	// Insert first pend element at the beginning
-	if (!pend.empty())
-		mainChain.push_front(pend[0]);
-	
-	// Insert remaining pend elements using binary search
-	for (size_t j = 1; j < pend.size(); ++j)
-	{
-		std::deque<int>::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), pend[j]);
-		mainChain.insert(pos, pend[j]);
-	}
-	
-	// Insert straggler if exists
-	if (straggler != -1)
-	{
-		std::deque<int>::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), straggler);
+		typename Container::iterator pos = std::lower_bound(mainChain.begin(), mainChain.end(), straggler);
 		mainChain.insert(pos, straggler);
 	}
 	
@@ -266,7 +177,7 @@ void PmergeMe::sort()
 	
 	// Sort with vector
 	gettimeofday(&start, NULL);
-	mergeInsertSortVector(_vectorData);
+	mergeInsertSort(_vectorData);
 	gettimeofday(&end, NULL);
 	
 	double vectorTime = (end.tv_sec - start.tv_sec) * 1000000.0;
@@ -282,7 +193,7 @@ void PmergeMe::sort()
 	
 	// Sort with deque
 	gettimeofday(&start, NULL);
-	mergeInsertSortDeque(_dequeData);
+	mergeInsertSort(_dequeData);
 	gettimeofday(&end, NULL);
 	
 	double dequeTime = (end.tv_sec - start.tv_sec) * 1000000.0;
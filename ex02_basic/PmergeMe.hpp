@@ -11,13 +11,11 @@ private:
 	std::vector<int> _vectorData;
 	std::deque<int> _dequeData;
 	
-	// Helper functions for vector
-	void mergeInsertSortVector(std::vector<int>& arr);
-	void insertionSortVector(std::vector<int>& arr, int left, int right);
-	
-	// Helper functions for deque
-	void mergeInsertSortDeque(std::deque<int>& arr);
-	void insertionSortDeque(std::deque<int>& arr, int left, int right);
+	// Helper functions, shared by vector and deque
+	template <typename Container>
+	void mergeInsertSort(Container& arr);
+	template <typename Container>
+	void insertionSort(Container& arr, int left, int right);
 	
 	// Validation
 	bool isValidNumber(const std::string& str) const;